@@ -7,6 +7,15 @@ TEST_CASE ("Boot performance")
         meter.measure ([&] (int i) { storage[(size_t) i].construct(); });
     };
 
+    BENCHMARK_ADVANCED ("Processor constructor, models already loaded")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        // Another instance keeps the shared model store alive, as on a busy session
+        PluginProcessor firstInstance;
+        std::vector<Catch::Benchmark::storage_for<PluginProcessor>> storage (size_t (meter.runs()));
+        meter.measure ([&] (int i) { storage[(size_t) i].construct(); });
+    };
+
     BENCHMARK_ADVANCED ("Processor destructor")
     (Catch::Benchmark::Chronometer meter)
     {
@@ -16,6 +25,15 @@ TEST_CASE ("Boot performance")
         meter.measure ([&] (int i) { storage[(size_t) i].destruct(); });
     };
 
+    BENCHMARK_ADVANCED ("Restore state")
+    (Catch::Benchmark::Chronometer meter)
+    {
+        PluginProcessor plugin;
+        juce::MemoryBlock state;
+        plugin.getStateInformation (state);
+        meter.measure ([&] { plugin.setStateInformation (state.getData(), (int) state.getSize()); });
+    };
+
     BENCHMARK_ADVANCED ("Editor open and close")
     (Catch::Benchmark::Chronometer meter)
     {
@@ -30,3 +48,175 @@ TEST_CASE ("Boot performance")
         });
     };
 }
+
+TEST_CASE ("Pitch estimator backends")
+{
+    constexpr double sampleRate = 44100.0;
+    const AnalysisConfig config;
+    const int windowSamples = config.getWindowSamples (sampleRate);
+    const int startSamples = config.getStartSamples (sampleRate);
+
+    Decimator decimator;
+    decimator.prepare (sampleRate, config.f0SampleRate);
+    const int factor = decimator.getFactor();
+    const double lowRate = decimator.getOutputRate();
+    const int lowWindow = windowSamples / factor;
+
+    SpectrumAnalyser spectrum;
+    spectrum.prepare (sampleRate, windowSamples, config.zeroPad);
+    const auto numBins = (size_t) spectrum.getNumBins();
+
+    // Synthetic corpus: every semitone from B0 to G4 at a few string stiffnesses,
+    // with the full-rate window, its decimated twin and its magnitude spectrum
+    struct Note
+    {
+        double f0;
+        std::vector<float> frame, lowFrame, magnitudes;
+    };
+
+    std::vector<Note> corpus;
+    for (int midi = 23; midi <= 67; ++midi)
+    {
+        for (const double beta : { 2.0e-5, 1.0e-4, 4.0e-4 })
+        {
+            Note n;
+            n.f0 = 440.0 * std::exp2 ((midi - 69) / 12.0);
+            auto note = makeBassNote (sampleRate, n.f0, 0.3, beta);
+            n.frame.assign (note.begin() + startSamples, note.begin() + (startSamples + windowSamples));
+
+            spectrum.compute (n.frame.data(), windowSamples);
+            n.magnitudes.assign (spectrum.getMagnitudes(), spectrum.getMagnitudes() + numBins);
+
+            decimator.reset();
+            decimator.process (note.data(), (int) note.size(), note.data());
+            const int lowStart = (startSamples + decimator.getLatency()) / factor;
+            n.lowFrame.assign (note.begin() + lowStart, note.begin() + (lowStart + lowWindow));
+            corpus.push_back (std::move (n));
+        }
+    }
+
+    PitchScratch scratch;
+    YinPitchDetector yin, lowRateYin;
+    McLeodPitchDetector mpm, lowRateMpm;
+    HpsPitchDetector hps;
+    yin.prepare (sampleRate, windowSamples, config.fMin, config.fMax, &scratch);
+    lowRateYin.prepare (lowRate, lowWindow, config.fMin, config.fMax, &scratch);
+    mpm.prepare (sampleRate, windowSamples, config.fMin, config.fMax, &scratch);
+    lowRateMpm.prepare (lowRate, lowWindow, config.fMin, config.fMax, &scratch);
+    hps.prepare (sampleRate, (int) numBins, windowSamples, config.fMin, config.fMax, &scratch);
+
+    const auto runYin = [&] (const Note& n) { return yin.estimate (n.frame.data(), windowSamples, config.yinThreshold); };
+    const auto runLowRateYin = [&] (const Note& n) { return lowRateYin.estimate (n.lowFrame.data(), lowWindow, config.yinThreshold); };
+    const auto runMpm = [&] (const Note& n) { return mpm.estimate (n.frame.data(), windowSamples, config.yinThreshold); };
+    const auto runLowRateMpm = [&] (const Note& n) { return lowRateMpm.estimate (n.lowFrame.data(), lowWindow, config.yinThreshold); };
+    const auto runHps = [&] (const Note& n) { return hps.estimate (n.magnitudes.data()); }; // the FFT is already paid for
+
+    // Anything more than a semitone off: octave (and fifth) errors, or no estimate at all
+    const auto reportErrors = [&] (const char* name, auto&& estimate) {
+        int errors = 0;
+        for (const auto& n : corpus)
+        {
+            const double f0 = estimate (n);
+            errors += ! (f0 > 0.0 && std::abs (12.0 * std::log2 (f0 / n.f0)) < 1.0);
+        }
+        WARN (name << ": " << errors << " / " << corpus.size() << " gross pitch errors");
+    };
+
+    reportErrors ("YIN", runYin);
+    reportErrors ("YIN low rate", runLowRateYin);
+    reportErrors ("MPM", runMpm);
+    reportErrors ("MPM low rate", runLowRateMpm);
+    reportErrors ("HPS", runHps);
+
+    const auto runCorpus = [&] (auto&& estimate) {
+        float sum = 0.0f;
+        for (const auto& n : corpus)
+            sum += estimate (n);
+        return sum;
+    };
+
+    BENCHMARK ("YIN") { return runCorpus (runYin); };
+    BENCHMARK ("YIN low rate") { return runCorpus (runLowRateYin); };
+    BENCHMARK ("MPM") { return runCorpus (runMpm); };
+    BENCHMARK ("MPM low rate") { return runCorpus (runLowRateMpm); };
+    BENCHMARK ("HPS") { return runCorpus (runHps); };
+}
+
+TEST_CASE ("String classifier backends")
+{
+    // Random weights, only the cost matters: the SVM with a typical number of
+    // support vectors against a 12 -> 32 -> 4 MLP, the physics prior and k-NN
+    juce::Random random (1);
+    const auto row = [&] (int n) {
+        juce::StringArray values;
+        for (int i = 0; i < n; ++i)
+            values.add (juce::String (random.nextFloat() * 2.0f - 1.0f));
+        return "[" + values.joinIntoString (",") + "]";
+    };
+    const auto matrix = [&] (int rows, int cols) {
+        juce::StringArray rowStrings;
+        for (int i = 0; i < rows; ++i)
+            rowStrings.add (row (cols));
+        return "[" + rowStrings.joinIntoString (",") + "]";
+    };
+
+    constexpr int svPerClass = 100;
+    const juce::String scaler = R"("scaler": { "mean": [0,0,0,0,0,0,0,0,0,0,0,100], "scale": [1,1,1,1,1,1,1,1,1,1,1,50] })";
+    const auto svmJson = "{" + scaler + R"(, "svm": { "classes": [1,2,3,4], "gamma": 0.1, "n_support": [)"
+                         + juce::String (svPerClass) + "," + juce::String (svPerClass) + "," + juce::String (svPerClass) + "," + juce::String (svPerClass)
+                         + "], \"support_vectors\": " + matrix (4 * svPerClass, kNumFeatures)
+                         + ", \"dual_coef\": " + matrix (3, 4 * svPerClass)
+                         + ", \"intercept\": " + row (6) + ", \"probA\": " + row (6) + ", \"probB\": " + row (6) + " } }";
+    const auto mlpJson = "{" + scaler + R"(, "mlp": { "classes": [1,2,3,4], "coefs": [)"
+                         + matrix (kNumFeatures, 32) + "," + matrix (32, 4)
+                         + "], \"intercepts\": [" + row (32) + "," + row (4) + "] } }";
+
+    juce::String error;
+    const auto svm = StringModel::fromJson (svmJson, error);
+    const auto mlp = StringModel::fromJson (mlpJson, error);
+    REQUIRE (svm != nullptr);
+    REQUIRE (mlp != nullptr);
+
+    StringClassifier svmClassifier, mlpClassifier;
+    svmClassifier.setModel (svm.get());
+    mlpClassifier.setModel (mlp.get());
+
+    // A2 fits on all four strings, so nothing is pruned
+    StringFeatures features {};
+    for (auto& f : features)
+        f = random.nextFloat();
+    features[featureF0] = 110.0f;
+    const auto& standard = getTuning (tuningStandard4);
+
+    BENCHMARK ("SVM, 400 support vectors") { return svmClassifier.predict (features, standard, kMaxFretLimit).stringIdx; };
+    BENCHMARK ("MLP, 12-32-4") { return mlpClassifier.predict (features, standard, kMaxFretLimit).stringIdx; };
+
+    // The physics prior over log β and three harmonic ratios, on its own
+    const juce::String curve = "[[-10,0.1155,0.3], [-9,0.1155,0.3], [-8,0.1155,0.3], [-7,0.1155,0.3]]";
+    const auto priorJson = R"({ "beta_prior": { "classes": [1,2,3,4], "curves": { "beta": )" + curve
+                           + ", \"a2_over_a1_log\": " + curve + ", \"a3_over_a1_log\": " + curve
+                           + ", \"a4_over_a1_log\": " + curve + " } } }";
+    const auto prior = StringModel::fromJson (priorJson, error);
+    REQUIRE (prior != nullptr);
+
+    StringClassifier priorClassifier;
+    priorClassifier.setModel (prior.get());
+    BENCHMARK ("Physics prior, 4 terms") { return priorClassifier.predict (features, standard, kMaxFretLimit).stringIdx; };
+
+    // k-NN over a training set of typical size and four times that, the cost should barely move
+    for (const int numSamples : { 2000, 8000 })
+    {
+        juce::StringArray labels;
+        for (int i = 0; i < numSamples; ++i)
+            labels.add (juce::String (1 + i % 4));
+
+        const auto knnJson = "{" + scaler + R"(, "knn": { "classes": [1,2,3,4], "k": 5, "samples": )" + matrix (numSamples, kNumFeatures)
+                             + ", \"labels\": [" + labels.joinIntoString (",") + "] } }";
+        const auto knn = StringModel::fromJson (knnJson, error);
+        REQUIRE (knn != nullptr);
+
+        StringClassifier knnClassifier;
+        knnClassifier.setModel (knn.get());
+        BENCHMARK ("k-NN, " + std::to_string (numSamples) + " samples") { return knnClassifier.predict (features, standard, kMaxFretLimit).stringIdx; };
+    }
+}
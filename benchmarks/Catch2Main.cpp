@@ -16,6 +16,7 @@ int main (int argc, char* argv[])
     return result;
 }
 
+#include "../tests/helpers/synthetic_bass.h"
 #include "PluginEditor.h"
 #include "catch2/benchmark/catch_benchmark_all.hpp"
 #include "catch2/catch_test_macros.hpp"
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "BassTuning.h"
+#include "PitchDetection.h"
+
+// ================================================================
+// Tunables for the note analysis pipeline.
+// Defaults mirror the notebook (estimate_f0_yin / track_harmonics_and_beta)
+// so the exported SVM sees features computed the same way it was trained on.
+constexpr int kMaxHarmonics = 16;
+constexpr int kMaxVoices = 3;
+
+struct AnalysisConfig
+{
+    // f0 search range (the notebook uses 30 Hz, lowered to keep a flat B0 on 5/6-string basses)
+    float fMin = 28.0f;
+    float fMax = 400.0f;
+    float yinThreshold = 0.1f;
+
+    // Onsets need to clear both an absolute level and the adaptive noise floor.
+    // The level is the default of the onset threshold parameter.
+    float onsetThreshold = 0.01f; // about -40 dBFS
+    float onsetFloorRatio = 4.0f; // +12 dB
+
+    // Post-attack sustain window used for f0 and harmonic tracking.
+    // Low latency mode starts it sooner, on the tail of the attack.
+    float startMs = 50.0f;
+    float lowLatencyStartMs = 25.0f;
+    float windowMs = 70.0f;
+    int numHarmonics = 6;
+    int zeroPad = 4;
+
+    // YIN runs on a decimated copy of the input at no less than this rate (0 = full rate)
+    double f0SampleRate = 4000.0;
+
+    // Single-note f0 estimator. HPS reuses the harmonic tracking FFT and is the
+    // cheapest, but needs partials at least a Hann main lobe apart (~40 Hz at 70 ms)
+    PitchBackend pitchBackend = PitchBackend::yin;
+
+    // Single notes also try f0 / 2 and 2 f0 and keep the playable one the spectrum
+    // supports best; the estimator's own f0 has to be beaten by octaveSwitchRatio
+    bool octaveCorrection = true;
+    float octaveSwitchRatio = 1.2f;
+
+    // Lag search for plucked notes (YIN backend) and for the legato tracker's re-acquisition
+    PitchSearch pitchSearch = PitchSearch::yin;
+    PitchSearch trackingSearch = PitchSearch::pyramid;
+
+    // 1 = monophonic (pitchBackend), 2..kMaxVoices = multi-f0 via harmonic cancellation
+    int maxVoices = 1;
+
+    // A further voice is only accepted when its salience is at least this
+    // fraction of the strongest one (keeps leftover partials from becoming notes)
+    float voiceSalienceRatio = 0.3f;
+
+    // Legato tracking: hop between pitch updates, and how many consecutive
+    // hops a new semitone has to hold before it counts as a note change
+    float trackingHopMs = 10.0f;
+    int trackingStableHops = 3;
+
+    // Position decoding: notes of lookahead before a note's string is final (0..2),
+    // and how long a pending note waits for the next one before it's committed anyway
+    int decoderLookahead = 1;
+    float decoderFlushMs = 400.0f;
+
+    // Inline (threadless) analysis: time per audio block spent on analysis steps.
+    // One step (an FFT, an f0 search or one voice's classification) always runs.
+    float inlineBudgetMs = 0.3f;
+
+    // Frames per single note whose string probabilities are combined, each
+    // voteHopMs after the last (1..FrameVote::kMaxFrames). With provisional
+    // results the first frame's guess is published as soon as it's analysed
+    // and the combined result follows once the later frames have been captured,
+    // so voting doesn't delay the first response.
+    int numVoteFrames = 3;
+    float voteHopMs = 20.0f;
+    bool provisionalResults = true;
+
+    // Offline bounces: latency doesn't matter, so longer and finer-grained
+    // analysis with more partials and several voting frames per note
+    static AnalysisConfig makeOffline()
+    {
+        AnalysisConfig c;
+        c.windowMs = 120.0f;
+        c.numHarmonics = 10;
+        c.zeroPad = 8;
+        c.numVoteFrames = 3;
+        c.voteHopMs = 30.0f;
+        c.provisionalResults = false;
+        return c;
+    }
+
+    int getStartSamples (double sampleRate) const { return (int) (sampleRate * startMs / 1000.0); }
+    int getLowLatencyStartSamples (double sampleRate) const { return (int) (sampleRate * lowLatencyStartMs / 1000.0); }
+    int getWindowSamples (double sampleRate) const { return (int) (sampleRate * windowMs / 1000.0); }
+    int getVoteHopSamples (double sampleRate) const { return (int) (sampleRate * voteHopMs / 1000.0); }
+    int getVoteSpanSamples (double sampleRate) const { return (numVoteFrames - 1) * getVoteHopSamples (sampleRate); }
+    int getCaptureSamples (double sampleRate) const { return getStartSamples (sampleRate) + getWindowSamples (sampleRate) + getVoteSpanSamples (sampleRate); }
+};
+
+// Per-block settings read on the audio thread and carried with each request
+struct AnalysisSettings
+{
+    int maxVoices { 1 };
+    int tuning { tuningStandard4 };
+    int maxFret { kDefaultMaxFret };
+    bool tracking { false }; // follow slides / hammer-ons between plucks
+    bool positionDecoding { false }; // pick strings over note sequences with a hand-position prior
+    float onsetThreshold { 0.01f }; // linear, see AnalysisConfig::onsetThreshold
+    bool lowLatency { false }; // capture window starts at lowLatencyStartMs
+    bool midiOutput { false }; // also queue detected notes for popMidiEvents()
+};
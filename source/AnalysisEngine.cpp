@@ -0,0 +1,693 @@
+#include "AnalysisEngine.h"
+#include <cmath>
+
+namespace
+{
+    int toMidi (float f0) { return (int) std::lround (69.0 + 12.0 * std::log2 (f0 / 440.0)); }
+} // namespace
+
+AnalysisEngine::AnalysisEngine() = default;
+
+AnalysisEngine::~AnalysisEngine()
+{
+    release();
+}
+
+void AnalysisEngine::prepare (double newSampleRate, int maxBlockSize)
+{
+    release();
+
+    sampleRate = newSampleRate;
+    config = offline ? AnalysisConfig::makeOffline() : AnalysisConfig();
+    startSamples = config.getStartSamples (sampleRate);
+    lowLatencyStartSamples = config.getLowLatencyStartSamples (sampleRate);
+    windowSamples = config.getWindowSamples (sampleRate);
+    captureSamples = startSamples + windowSamples;
+    hopSamples = juce::jmax (1, (int) (sampleRate * config.trackingHopMs / 1000.0));
+    voteHopSamples = config.getVoteHopSamples (sampleRate);
+    voteSpanSamples = config.getVoteSpanSamples (sampleRate);
+
+    // A few seconds of history, so a busy worker can still reach old notes
+    const auto ringSize = (int64_t) juce::nextPowerOfTwo (juce::jmax (captureSamples + voteSpanSamples + maxBlockSize, (int) (sampleRate * 4.0)));
+    ring.assign ((size_t) ringSize, 0.0f);
+    ringMask = ringSize - 1;
+    samplesWritten.store (0);
+
+    // Low-rate copy for f0, same span of history
+    decimator.prepare (sampleRate, config.f0SampleRate > 0.0 ? config.f0SampleRate : sampleRate);
+    decimation = decimator.getFactor();
+    lowWindowSamples = windowSamples / decimation;
+    lowRing.assign ((size_t) (ringSize / decimation), 0.0f);
+    lowRingMask = ringSize / decimation - 1;
+    lowSamplesWritten.store (0);
+    lowBlock.assign ((size_t) (juce::jmax (1, maxBlockSize) / decimation + 1), 0.0f);
+
+    humFilter.prepare (sampleRate);
+    noiseFloor.prepare (sampleRate);
+    conditioned.assign ((size_t) juce::jmax (1, maxBlockSize), 0.0f);
+
+    onsetDetector.prepare (sampleRate, captureSamples);
+    numPending = 0;
+    lastOnsetSample.store (0);
+    requestFifo.reset();
+    eventFifo.reset();
+    midiFifo.reset();
+
+    frame.assign ((size_t) windowSamples, 0.0f);
+    lowFrame.assign ((size_t) lowWindowSamples, 0.0f);
+    analyser.prepare (sampleRate, config, decimation);
+    modelVersion = 0; // hand the models over on the first service()
+
+    tracker.prepare (decimator.getOutputRate(), config.fMin, config.fMax);
+    tracker.setSearch (config.trackingSearch);
+    trackFrame.assign ((size_t) tracker.getRequiredWindow(), 0.0f); // unlocked is the widest
+    lastTrackedEnd = 0;
+    trackedMidi = candidateMidi = -1;
+    candidateHops = 0;
+    lastNote = {};
+
+    decoder.prepare (sampleRate);
+    decoder.setLookahead (config.decoderLookahead);
+    decoderFlushSamples = (int64_t) (sampleRate * config.decoderFlushMs / 1000.0);
+
+    inlineRequest = {};
+    inlineBusy = false;
+    inlineFrame = 0;
+    voteRequest = {};
+    voting = false;
+    voteFrame = 0;
+    inlineBudgetTicks = juce::jmax ((int64_t) 1, (int64_t) ((double) juce::Time::getHighResolutionTicksPerSecond() * config.inlineBudgetMs / 1000.0));
+
+    // Without a reader slot the models as they are now stay in use until the next prepare()
+    modelReader = modelStore->addReader();
+    if (modelReader < 0)
+        unslottedModels = modelStore->copyModels();
+    registered = true;
+    poolUnavailable = false;
+
+    // The pool's workers are only started (or kept alive) for instances that use them
+    if (runsInline())
+    {
+        pool.reset();
+        return;
+    }
+
+    if (! pool.has_value())
+        pool.emplace();
+
+    if ((*pool)->add (this))
+        return;
+
+    // Every slot is taken or no worker could start; the analysis still has to happen
+    pool.reset();
+    poolUnavailable = true;
+}
+
+void AnalysisEngine::release()
+{
+    if (registered)
+    {
+        if (pool.has_value())
+            (*pool)->remove (this);
+        modelStore->removeReader (modelReader);
+        modelReader = -1;
+        unslottedModels = {};
+    }
+    registered = false;
+}
+
+//==============================================================================
+void AnalysisEngine::process (const float* mono, int numSamples, const AnalysisSettings& settings)
+{
+    if (ring.empty() || numSamples <= 0)
+        return;
+
+    // Hum and noise only get in the way of onsets and f0, the ring holds the cleaned signal
+    const auto maxChunk = (int) conditioned.size();
+    for (int pos = 0; pos < numSamples; pos += maxChunk)
+    {
+        const auto n = juce::jmin (maxChunk, numSamples - pos);
+        std::copy_n (mono + pos, n, conditioned.data());
+        humFilter.process (conditioned.data(), n, noiseFloor.isQuiet());
+        noiseFloor.process (conditioned.data(), n);
+        processConditioned (conditioned.data(), n, settings);
+    }
+
+    if (runsInline())
+        serviceInline();
+}
+
+void AnalysisEngine::processConditioned (const float* mono, int numSamples, const AnalysisSettings& settings)
+{
+    // Append to the ring (we're the only writer, so a relaxed load is enough)
+    const auto base = samplesWritten.load (std::memory_order_relaxed);
+    const auto ringSize = (int64_t) ring.size();
+    const auto start = (int) (base & ringMask);
+    const auto first = (int) juce::jmin ((int64_t) numSamples, ringSize - start);
+    std::copy_n (mono, first, ring.data() + start);
+    std::copy_n (mono + first, numSamples - first, ring.data());
+    samplesWritten.store (base + numSamples, std::memory_order_release);
+
+    const auto lowBase = lowSamplesWritten.load (std::memory_order_relaxed);
+    const int numLow = decimator.process (mono, numSamples, lowBlock.data());
+    for (int i = 0; i < numLow; ++i)
+        lowRing[(size_t) ((lowBase + i) & lowRingMask)] = lowBlock[(size_t) i];
+    lowSamplesWritten.store (lowBase + numLow, std::memory_order_release);
+
+    liveTracking.store (settings.tracking, std::memory_order_relaxed);
+    liveTuning.store (settings.tuning, std::memory_order_relaxed);
+    liveMaxFret.store (settings.maxFret, std::memory_order_relaxed);
+    liveQuiet.store (noiseFloor.isQuiet(), std::memory_order_relaxed);
+    liveMidiOutput.store (settings.midiOutput, std::memory_order_relaxed);
+
+    // Pickup noise and leftover hum shouldn't read as plucks
+    onsetDetector.setThreshold (juce::jmax (settings.onsetThreshold, noiseFloor.getFloor() * config.onsetFloorRatio));
+
+    int onsets[OnsetDetector::kMaxOnsetsPerBlock];
+    const int numOnsets = onsetDetector.process (mono, numSamples, onsets);
+    for (int i = 0; i < numOnsets && numPending < (int) pendingOnsets.size(); ++i)
+        pendingOnsets[(size_t) numPending++] = base + onsets[i];
+
+    if (numOnsets > 0)
+        lastOnsetSample.store (base + onsets[numOnsets - 1], std::memory_order_relaxed);
+
+    // Hand over every note whose sustain window is now complete. With provisional
+    // results the first frame goes straight away, the voting frames are picked up as they come in.
+    const auto end = base + numSamples;
+    const auto windowStart = settings.lowLatency ? lowLatencyStartSamples : startSamples;
+    const auto waitForVotes = config.provisionalResults ? 0 : voteSpanSamples;
+    bool posted = false;
+    for (int i = 0; i < numPending;)
+    {
+        const auto onset = pendingOnsets[(size_t) i];
+        if (end < onset + windowStart + windowSamples + waitForVotes + decimator.getLatency())
+        {
+            ++i;
+            continue;
+        }
+
+        Request r;
+        r.onsetSample = onset;
+        r.frameStart = onset + windowStart;
+        r.settings = settings;
+        requestFifo.write (1).forEach ([&] (int index) { requests[(size_t) index] = r; });
+        posted = true;
+
+        for (int j = i + 1; j < numPending; ++j)
+            pendingOnsets[(size_t) j - 1] = pendingOnsets[(size_t) j];
+        --numPending;
+    }
+
+    if (posted && ! runsInline())
+        (*pool)->notify();
+}
+
+int AnalysisEngine::popNoteEvents (NoteEvent* dest, int maxEvents)
+{
+    int numRead = 0;
+    eventFifo.read (juce::jmin (maxEvents, eventFifo.getNumReady())).forEach ([&] (int index) {
+        dest[numRead++] = events[(size_t) index];
+    });
+    return numRead;
+}
+
+int AnalysisEngine::popMidiEvents (NoteEvent* dest, int maxEvents)
+{
+    int numRead = 0;
+    midiFifo.read (juce::jmin (maxEvents, midiFifo.getNumReady())).forEach ([&] (int index) {
+        dest[numRead++] = midiEvents[(size_t) index];
+    });
+    return numRead;
+}
+
+//==============================================================================
+bool AnalysisEngine::service()
+{
+    // Pin the models for this slice, a newly published set shows up at the next one
+    std::optional<StringModelStore::ReadScope> pinned;
+    if (modelReader >= 0)
+        pinned.emplace (*modelStore, modelReader);
+    updateModels (pinned.has_value() ? &*pinned : nullptr);
+
+    continueVote();
+
+    // A few requests per turn, the pool's workers are shared with other instances
+    constexpr int kMaxRequestsPerService = 4;
+    for (int i = 0; i < kMaxRequestsPerService && requestFifo.getNumReady() > 0; ++i)
+    {
+        Request r;
+        requestFifo.read (1).forEach ([&] (int index) { r = requests[(size_t) index]; });
+        analyseRequest (r);
+    }
+
+    // Nothing followed the last notes for a while, they won't get more context
+    if (decoder.getNumPending() > 0 && samplesWritten.load (std::memory_order_relaxed) - decoder.getLastOnset() > decoderFlushSamples)
+        flushDecoder();
+
+    if (liveTracking.load (std::memory_order_relaxed))
+        trackLatest();
+
+    return requestFifo.getNumReady() > 0;
+}
+
+int AnalysisEngine::getServiceIntervalMs() const
+{
+    const int interval = liveTracking.load (std::memory_order_relaxed) ? (int) std::ceil (config.trackingHopMs) : 100;
+
+    // Back for the next voting frame as soon as it's been captured
+    return voting ? juce::jmin (interval, (int) std::ceil (config.voteHopMs)) : interval;
+}
+
+void AnalysisEngine::updateModels (const StringModelStore::ReadScope* pinned)
+{
+    // Store versions start at 1, so 0 means nothing has been handed over yet
+    const auto version = pinned != nullptr ? pinned->getVersion() : (uint64_t) 1;
+    if (version != modelVersion)
+    {
+        analyser.setModels (pinned != nullptr ? pinned->getModels() : unslottedModels);
+        modelVersion = version;
+    }
+}
+
+void AnalysisEngine::serviceInline()
+{
+    std::optional<StringModelStore::ReadScope> pinned;
+    if (modelReader >= 0)
+        pinned.emplace (*modelStore, modelReader);
+    updateModels (pinned.has_value() ? &*pinned : nullptr);
+
+    // Always at least one step, so a block size below the cost of one still gets through.
+    // Offline there's no budget: every note is done before the block returns.
+    const auto deadline = juce::Time::getHighResolutionTicks() + inlineBudgetTicks;
+    bool stepped = stepInline();
+    while (stepped && (offline || juce::Time::getHighResolutionTicks() < deadline))
+        stepped = stepInline();
+
+    if (inlineBusy || voting || requestFifo.getNumReady() > 0)
+        return;
+
+    // Idle otherwise, same housekeeping as service()
+    if (decoder.getNumPending() > 0 && samplesWritten.load (std::memory_order_relaxed) - decoder.getLastOnset() > decoderFlushSamples)
+        flushDecoder();
+
+    // A hop's pitch search costs about as much as a step, so it needs budget left too
+    if (liveTracking.load (std::memory_order_relaxed) && (offline || juce::Time::getHighResolutionTicks() < deadline))
+        trackLatest();
+}
+
+bool AnalysisEngine::stepInline()
+{
+    // A half-done note carries on where the last block left it
+    if (inlineBusy)
+    {
+        if (analyser.step (inlineResults.data()))
+        {
+            inlineBusy = false;
+            finishInlineFrame();
+        }
+        return true;
+    }
+
+    // The voting frames of the last note, each as soon as it's been captured
+    if (beginNextVoteFrame())
+        return true;
+
+    if (requestFifo.getNumReady() == 0)
+        return false;
+
+    // The next note doesn't wait for frames that haven't come in yet
+    settleVote();
+
+    requestFifo.read (1).forEach ([&] (int index) { inlineRequest = requests[(size_t) index]; });
+    inlineFrame = 0;
+    inlineBusy = copyWindow (inlineRequest.frameStart);
+    if (inlineBusy)
+        analyser.begin (frame.data(), windowSamples, inlineRequest.settings, lowFrame.data(), lowWindowSamples);
+    return true;
+}
+
+void AnalysisEngine::finishInlineFrame()
+{
+    const int numVoices = analyser.getNumVoices();
+
+    if (inlineRequest.legato)
+        finishLegato (inlineRequest.onsetSample, inlineResults.data(), numVoices);
+    else if (inlineFrame > 0)
+    {
+        if (numVoices == 1)
+            vote.add (inlineResults[0]);
+    }
+    else if (! startVote (inlineRequest, inlineResults.data(), numVoices))
+        finishRequest (inlineRequest, inlineResults.data(), numVoices);
+}
+
+bool AnalysisEngine::beginNextVoteFrame()
+{
+    switch (getVoteFrameState())
+    {
+        case FrameState::pending:
+            return false;
+
+        case FrameState::done:
+            settleVote();
+            return false;
+
+        case FrameState::captured:
+            break;
+    }
+
+    inlineRequest = voteRequest;
+    inlineFrame = voteFrame;
+    inlineBusy = copyWindow (getVoteFrameStart());
+    ++voteFrame;
+
+    if (inlineBusy)
+        analyser.begin (frame.data(), windowSamples, getVoteSettings (voteRequest.settings), lowFrame.data(), lowWindowSamples);
+    return true;
+}
+
+//==============================================================================
+bool AnalysisEngine::isCaptured (int64_t frameStart) const
+{
+    // The decimated window covering the same span, allowing for the filter delay, lags the full-rate one
+    const auto lowStart = (frameStart + decimator.getLatency() + decimation - 1) / decimation;
+    return lowSamplesWritten.load (std::memory_order_acquire) >= lowStart + lowWindowSamples;
+}
+
+bool AnalysisEngine::copyWindow (int64_t frameStart)
+{
+    if (! isCaptured (frameStart))
+        return false;
+
+    const auto lowStart = (frameStart + decimator.getLatency() + decimation - 1) / decimation;
+
+    const auto ringSize = (int64_t) ring.size();
+    const auto isOverwritten = [&] { return samplesWritten.load (std::memory_order_acquire) - frameStart > ringSize; };
+
+    if (isOverwritten())
+        return false;
+
+    for (int i = 0; i < windowSamples; ++i)
+        frame[(size_t) i] = ring[(size_t) ((frameStart + i) & ringMask)];
+
+    for (int i = 0; i < lowWindowSamples; ++i)
+        lowFrame[(size_t) i] = lowRing[(size_t) ((lowStart + i) & lowRingMask)];
+
+    // The audio thread may have lapped us while copying
+    return ! isOverwritten();
+}
+
+void AnalysisEngine::analyseRequest (const Request& r)
+{
+    // The last note's vote ends here, with whatever frames have come in
+    continueVote();
+    settleVote();
+
+    if (! copyWindow (r.frameStart))
+        return;
+
+    NoteEvent results[kMaxVoices];
+    const int numVoices = analyser.analyse (frame.data(), windowSamples, r.settings, results, lowFrame.data(), lowWindowSamples);
+
+    if (startVote (r, results, numVoices))
+        continueVote();
+    else
+        finishRequest (r, results, numVoices);
+}
+
+//==============================================================================
+bool AnalysisEngine::startVote (const Request& r, const NoteEvent* results, int numVoices)
+{
+    // Later frames of the same note refine a single note's string; chords keep the first
+    if (r.legato || config.numVoteFrames <= 1 || numVoices != 1 || ! results[0].isValid())
+        return false;
+
+    vote.reset();
+    vote.add (results[0]);
+    voteRequest = r;
+    voteFrame = 1;
+    voting = true;
+
+    // Shown straight away, the voted event for the same onset follows
+    if (config.provisionalResults)
+    {
+        auto guess = results[0];
+        guess.onsetSample = r.onsetSample;
+        guess.provisional = true;
+        pushEvents (&guess, 1);
+    }
+
+    return true;
+}
+
+AnalysisEngine::FrameState AnalysisEngine::getVoteFrameState() const
+{
+    if (! voting || voteFrame >= config.numVoteFrames)
+        return FrameState::done;
+
+    // A new pluck inside the frame would be voted on as this note
+    const auto frameStart = getVoteFrameStart();
+    const auto latestOnset = lastOnsetSample.load (std::memory_order_relaxed);
+    if (latestOnset > voteRequest.onsetSample && latestOnset < frameStart + windowSamples)
+        return FrameState::done;
+
+    return isCaptured (frameStart) ? FrameState::captured : FrameState::pending;
+}
+
+AnalysisSettings AnalysisEngine::getVoteSettings (const AnalysisSettings& settings) const
+{
+    // The first frame already settled that it's one note
+    auto single = settings;
+    single.maxVoices = 1;
+    return single;
+}
+
+void AnalysisEngine::continueVote()
+{
+    for (;;)
+    {
+        switch (getVoteFrameState())
+        {
+            case FrameState::pending:
+                return;
+
+            case FrameState::done:
+                settleVote();
+                return;
+
+            case FrameState::captured:
+                break;
+        }
+
+        NoteEvent e;
+        if (copyWindow (getVoteFrameStart())
+            && analyser.analyse (frame.data(), windowSamples, getVoteSettings (voteRequest.settings), &e, lowFrame.data(), lowWindowSamples) == 1)
+            vote.add (e);
+
+        ++voteFrame;
+    }
+}
+
+void AnalysisEngine::settleVote()
+{
+    if (! voting)
+        return;
+
+    voting = false;
+    auto result = vote.getResult (voteRequest.settings.maxFret);
+    finishRequest (voteRequest, &result, 1);
+}
+
+void AnalysisEngine::finishRequest (const Request& r, NoteEvent* results, int numVoices)
+{
+    for (int v = 0; v < numVoices; ++v)
+        results[v].onsetSample = r.onsetSample;
+
+    // A plucked single note is where legato tracking picks up from
+    candidateMidi = -1;
+    candidateHops = 0;
+    if (numVoices == 1 && results[0].isValid())
+    {
+        tracker.prime (results[0].f0);
+        trackedMidi = toMidi (results[0].f0);
+        lastNote = results[0];
+    }
+    else
+    {
+        tracker.reset();
+        trackedMidi = -1;
+        lastNote = {};
+    }
+
+    if (r.settings.positionDecoding && numVoices == 1)
+    {
+        NoteEvent decoded[PositionDecoder::kMaxOutput];
+        pushDecoded (decoded, decoder.push (results[0], r.settings.maxFret, decoded));
+        return;
+    }
+
+    // Chords and rests break the note sequence the decoder works on
+    flushDecoder();
+    decoder.reset();
+    pushEvents (results, numVoices);
+}
+
+//==============================================================================
+void AnalysisEngine::trackLatest()
+{
+    const auto written = samplesWritten.load (std::memory_order_acquire);
+    if (written - lastTrackedEnd < hopSamples)
+        return;
+
+    // Nothing but noise, don't spend a pitch search on it
+    if (liveQuiet.load (std::memory_order_relaxed))
+    {
+        tracker.reset();
+        candidateMidi = -1;
+        candidateHops = 0;
+        return;
+    }
+
+    // Leave the attack to the onset path until its request has been analysed and voted on
+    if (written < lastOnsetSample.load (std::memory_order_relaxed) + captureSamples || voting || requestFifo.getNumReady() > 0)
+        return;
+
+    lastTrackedEnd = written;
+
+    // The tracker runs on the decimated stream
+    const auto lowWritten = lowSamplesWritten.load (std::memory_order_acquire);
+    const int n = juce::jmin (tracker.getRequiredWindow(), (int) trackFrame.size());
+    if (lowWritten < n)
+        return;
+
+    for (int i = 0; i < n; ++i)
+        trackFrame[(size_t) i] = lowRing[(size_t) ((lowWritten - n + i) & lowRingMask)];
+
+    const float f0 = tracker.process (trackFrame.data(), n);
+    if (f0 <= 0.0f)
+    {
+        candidateMidi = -1;
+        candidateHops = 0;
+        return;
+    }
+
+    // Only a new semitone that holds for a few hops is a note change,
+    // vibrato and the glide of a slide in between are ignored
+    const int midi = toMidi (f0);
+    if (midi == trackedMidi)
+    {
+        candidateMidi = -1;
+        candidateHops = 0;
+        return;
+    }
+
+    if (midi != candidateMidi)
+    {
+        candidateMidi = midi;
+        candidateHops = 0;
+    }
+
+    if (++candidateHops < config.trackingStableHops)
+        return;
+
+    trackedMidi = midi;
+    candidateMidi = -1;
+    candidateHops = 0;
+    emitLegato (f0, written);
+}
+
+void AnalysisEngine::emitLegato (float f0, int64_t position)
+{
+    // The pluck this continues from has to be published (and final) first
+    flushDecoder();
+    decoder.reset();
+
+    AnalysisSettings settings;
+    settings.tuning = liveTuning.load (std::memory_order_relaxed);
+    settings.maxFret = liveMaxFret.load (std::memory_order_relaxed);
+    const auto& tuning = getTuning (settings.tuning);
+
+    // Legato stays on the string that was plucked, so only the fret moves
+    if (lastNote.isValid() && lastNote.tuning == settings.tuning
+        && tuning.isPlayable (f0, lastNote.stringIdx, settings.maxFret))
+    {
+        auto e = lastNote;
+        e.f0 = f0;
+        e.fret = tuning.getFret (f0, e.stringIdx, settings.maxFret);
+        e.voice = 0;
+        e.numVoices = 1;
+        e.onsetSample = position;
+        e.legato = true;
+        lastNote = e;
+        pushEvents (&e, 1);
+        return;
+    }
+
+    // The note has left that string, run the full classifier on the latest
+    // window whose decimated copy is complete too
+    const auto frameStart = position - decimator.getLatency() - windowSamples;
+    if (frameStart < 0 || ! copyWindow (frameStart))
+        return;
+
+    // Inline, it's stepped through across blocks like a plucked note
+    if (runsInline())
+    {
+        inlineRequest.frameStart = frameStart;
+        inlineRequest.onsetSample = position;
+        inlineRequest.settings = settings;
+        inlineRequest.legato = true;
+        inlineFrame = 0;
+        analyser.begin (frame.data(), windowSamples, settings, lowFrame.data(), lowWindowSamples);
+        inlineBusy = true;
+        return;
+    }
+
+    NoteEvent e;
+    const int numVoices = analyser.analyse (frame.data(), windowSamples, settings, &e, lowFrame.data(), lowWindowSamples);
+    finishLegato (position, &e, numVoices);
+}
+
+void AnalysisEngine::finishLegato (int64_t position, NoteEvent* results, int numVoices)
+{
+    if (numVoices != 1 || ! results[0].isValid())
+        return;
+
+    auto& e = results[0];
+    e.onsetSample = position;
+    e.legato = true;
+    lastNote = e;
+    pushEvents (&e, 1);
+}
+
+void AnalysisEngine::pushEvents (const NoteEvent* newEvents, int numEvents)
+{
+    int i = 0;
+    eventFifo.write (juce::jmin (numEvents, eventFifo.getFreeSpace())).forEach ([&] (int index) {
+        events[(size_t) index] = newEvents[i++];
+    });
+
+    // A provisional guess could be corrected, MIDI waits for the final event
+    if (! liveMidiOutput.load (std::memory_order_relaxed) || (numEvents > 0 && newEvents[0].provisional))
+        return;
+
+    i = 0;
+    midiFifo.write (juce::jmin (numEvents, midiFifo.getFreeSpace())).forEach ([&] (int index) {
+        midiEvents[(size_t) index] = newEvents[i++];
+    });
+}
+
+void AnalysisEngine::pushDecoded (const NoteEvent* decoded, int numDecoded)
+{
+    // The decoder may have moved the pluck that legato tracking continues from
+    for (int i = 0; i < numDecoded; ++i)
+        if (lastNote.isValid() && ! lastNote.legato && decoded[i].onsetSample == lastNote.onsetSample)
+            lastNote = decoded[i];
+
+    pushEvents (decoded, numDecoded);
+}
+
+void AnalysisEngine::flushDecoder()
+{
+    NoteEvent decoded[PositionDecoder::kMaxOutput];
+    pushDecoded (decoded, decoder.flush (decoded));
+}
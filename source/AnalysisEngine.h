@@ -0,0 +1,207 @@
+#pragma once
+
+#include "AnalysisThreadPool.h"
+#include "Decimator.h"
+#include "HumFilter.h"
+#include "ModelStore.h"
+#include "NoiseFloor.h"
+#include "NoteAnalyser.h"
+#include "NoteEvent.h"
+#include "OnsetDetector.h"
+#include "PitchTracker.h"
+#include "PositionDecoder.h"
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <optional>
+
+// ================================================================
+// Bridges the audio thread and the note analyser.
+// The audio thread only cleans up the input (hum notches, noise floor),
+// appends it to a ring and detects onsets;
+// once a note's sustain window has been captured, a request goes through
+// a lock-free FIFO to the process-wide analysis pool, whose results come
+// back through another FIFO for the UI to poll.
+// In tracking mode the worker also follows the pitch at hop rate between
+// plucks, so slides and hammer-ons show up without a new onset.
+// With position decoding, plucked single notes pass through a short
+// lookahead decoder before they're published.
+// A single note is voted on over a few frames; its first frame's guess is
+// published provisionally and the voted result follows once the later frames
+// have been captured.
+// Models come from the process-wide store and are pinned for one service()
+// slice at a time, so a hot-swapped model is picked up at the next slice.
+// For hosts that don't want plugin threads, the inline mode does the same
+// work in process() instead, in steps under a fixed per-block time budget.
+// It's also the fallback when the shared pool can't take another instance.
+class AnalysisEngine : private AnalysisThreadPool::Client
+{
+public:
+    AnalysisEngine();
+    ~AnalysisEngine() override;
+
+    // Message thread, before prepare(). Inline analysis never starts a thread.
+    // Also true after prepare() when the pool had no room or no workers.
+    void setInlineAnalysis (bool shouldRunInline) { inlineAnalysis = shouldRunInline; }
+    bool isInlineAnalysis() const { return inlineAnalysis || poolUnavailable; }
+
+    // Message thread, before prepare(). Offline (non-realtime) rendering uses
+    // AnalysisConfig::makeOffline() and analyses every note synchronously in process().
+    void setOffline (bool shouldBeOffline) { offline = shouldBeOffline; }
+    bool isOffline() const { return offline; }
+
+    void prepare (double sampleRate, int maxBlockSize);
+    void release();
+
+    // Audio thread, never blocks or allocates
+    void process (const float* mono, int numSamples, const AnalysisSettings& settings);
+
+    // Single consumer (usually the editor's timer)
+    int popNoteEvents (NoteEvent* dest, int maxEvents);
+
+    // Audio thread, the notes published while settings.midiOutput was on
+    int popMidiEvents (NoteEvent* dest, int maxEvents);
+
+    // Audio thread, after process(): the input has died down to the noise floor
+    bool isQuiet() const { return liveQuiet.load (std::memory_order_relaxed); }
+
+private:
+    struct Request
+    {
+        int64_t frameStart { 0 };
+        int64_t onsetSample { 0 };
+        AnalysisSettings settings;
+        bool legato { false }; // inline mode only: a legato note that left its string
+    };
+
+    void processConditioned (const float* x, int numSamples, const AnalysisSettings& settings);
+    bool service() override;
+    int getServiceIntervalMs() const override;
+    void updateModels (const StringModelStore::ReadScope* pinned);
+    bool runsInline() const { return isInlineAnalysis() || offline; }
+    void serviceInline();
+    bool stepInline();
+    void finishInlineFrame();
+    bool beginNextVoteFrame();
+    bool isCaptured (int64_t frameStart) const;
+    bool copyWindow (int64_t frameStart);
+    void analyseRequest (const Request& request);
+
+    enum class FrameState
+    {
+        captured,
+        pending, // still being recorded
+        done // every frame voted on, or the rest overlaps the next pluck
+    };
+
+    bool startVote (const Request& request, const NoteEvent* results, int numVoices);
+    FrameState getVoteFrameState() const;
+    int64_t getVoteFrameStart() const { return voteRequest.frameStart + voteFrame * voteHopSamples; }
+    AnalysisSettings getVoteSettings (const AnalysisSettings& settings) const;
+    void continueVote();
+    void settleVote();
+    void finishRequest (const Request& request, NoteEvent* results, int numVoices);
+    void trackLatest();
+    void emitLegato (float f0, int64_t position);
+    void finishLegato (int64_t position, NoteEvent* results, int numVoices);
+    void pushEvents (const NoteEvent* events, int numEvents);
+    void pushDecoded (const NoteEvent* decoded, int numDecoded);
+    void flushDecoder();
+
+    double sampleRate { 44100.0 };
+    AnalysisConfig config;
+    int captureSamples { 0 };
+    int windowSamples { 0 };
+    int startSamples { 0 };
+    int lowLatencyStartSamples { 0 };
+    int hopSamples { 0 };
+    int voteHopSamples { 0 };
+    int voteSpanSamples { 0 };
+
+    // Mono history written by the audio thread
+    std::vector<float> ring;
+    int64_t ringMask { 0 };
+    std::atomic<int64_t> samplesWritten { 0 };
+
+    // Decimated copy of the same history for f0 estimation
+    Decimator decimator;
+    int decimation { 1 };
+    std::vector<float> lowRing;
+    int64_t lowRingMask { 0 };
+    std::atomic<int64_t> lowSamplesWritten { 0 };
+    std::vector<float> lowBlock;
+
+    // Input conditioning (audio thread only)
+    HumFilter humFilter;
+    NoiseFloor noiseFloor;
+    std::vector<float> conditioned;
+
+    // Onsets whose capture window is still filling (audio thread only)
+    OnsetDetector onsetDetector;
+    std::array<int64_t, 8> pendingOnsets {};
+    int numPending { 0 };
+
+    // Latest settings and onset, for the tracker between requests
+    std::atomic<bool> liveTracking { false };
+    std::atomic<int> liveTuning { tuningStandard4 };
+    std::atomic<int> liveMaxFret { kDefaultMaxFret };
+    std::atomic<int64_t> lastOnsetSample { 0 };
+    std::atomic<bool> liveQuiet { true };
+    std::atomic<bool> liveMidiOutput { false };
+
+    static constexpr int kRequestFifoSize = 32;
+    juce::AbstractFifo requestFifo { kRequestFifoSize };
+    std::array<Request, kRequestFifoSize> requests;
+
+    static constexpr int kEventFifoSize = 128;
+    juce::AbstractFifo eventFifo { kEventFifoSize };
+    std::array<NoteEvent, kEventFifoSize> events;
+
+    static constexpr int kMidiFifoSize = 64;
+    juce::AbstractFifo midiFifo { kMidiFifoSize };
+    std::array<NoteEvent, kMidiFifoSize> midiEvents;
+
+    std::optional<juce::SharedResourcePointer<AnalysisThreadPool>> pool; // unset in inline mode
+    bool registered { false }; // prepared, with the pool unless inline (message thread)
+    bool inlineAnalysis { false };
+    bool poolUnavailable { false }; // the pool couldn't take this instance at prepare(), so it runs inline
+    bool offline { false };
+    NoteAnalyser analyser;
+    std::vector<float> frame;
+    std::vector<float> lowFrame;
+    int lowWindowSamples { 0 };
+
+    juce::SharedResourcePointer<StringModelStore> modelStore;
+    int modelReader { -1 }; // our reader slot in the store (message thread)
+    StringModelSlots unslottedModels; // used instead when every reader slot was taken at prepare()
+    uint64_t modelVersion { 0 }; // of the set the analyser points at (worker thread only)
+
+    // Tracking state (worker thread only)
+    PitchTracker tracker;
+    std::vector<float> trackFrame;
+    int64_t lastTrackedEnd { 0 };
+    int trackedMidi { -1 };
+    int candidateMidi { -1 };
+    int candidateHops { 0 };
+    NoteEvent lastNote; // the note legato changes are relative to
+
+    // Position decoding (worker thread only)
+    PositionDecoder decoder;
+    int64_t decoderFlushSamples { 0 };
+
+    // Single notes analysed over several frames (worker, or audio thread inline)
+    FrameVote vote;
+    Request voteRequest;
+    bool voting { false };
+    int voteFrame { 0 }; // the next one to analyse
+
+    // Inline mode: the request being stepped through across blocks (audio thread only)
+    Request inlineRequest;
+    bool inlineBusy { false };
+    int inlineFrame { 0 }; // of the request's voting frames
+    std::array<NoteEvent, kMaxVoices> inlineResults;
+    int64_t inlineBudgetTicks { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalysisEngine)
+};
@@ -0,0 +1,166 @@
+#include "AnalysisThreadPool.h"
+
+#if JUCE_MAC || JUCE_IOS
+    #include <dispatch/dispatch.h>
+#else
+    #include <semaphore>
+#endif
+
+// Posting never blocks or takes a lock, so notify() is safe on the audio thread.
+// std::counting_semaphore needs macOS 11, so Apple platforms use libdispatch.
+class AnalysisThreadPool::WakeSemaphore
+{
+public:
+#if JUCE_MAC || JUCE_IOS
+    WakeSemaphore() : semaphore (dispatch_semaphore_create (0)) {}
+    ~WakeSemaphore() { dispatch_release (semaphore); }
+
+    void post() { dispatch_semaphore_signal (semaphore); }
+
+    bool wait (int timeoutMs)
+    {
+        return dispatch_semaphore_wait (semaphore, dispatch_time (DISPATCH_TIME_NOW, (int64_t) timeoutMs * (int64_t) NSEC_PER_MSEC)) == 0;
+    }
+
+private:
+    dispatch_semaphore_t semaphore;
+#else
+    void post() { semaphore.release(); }
+    bool wait (int timeoutMs) { return semaphore.try_acquire_for (std::chrono::milliseconds (timeoutMs)); }
+
+private:
+    // One pending wake, plus one per worker when shutting down
+    std::counting_semaphore<kMaxWorkers + 1> semaphore { 0 };
+#endif
+};
+
+class AnalysisThreadPool::Worker : public juce::Thread
+{
+public:
+    Worker (AnalysisThreadPool& p, int homeSlot)
+        : juce::Thread ("Bass analysis"), pool (p), home (homeSlot)
+    {
+    }
+
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            // Keep going while anyone has a backlog, otherwise sleep until notified
+            if (! pool.serviceAll (home))
+                pool.waitForWork (pool.getWaitMs());
+        }
+    }
+
+private:
+    AnalysisThreadPool& pool;
+    const int home;
+};
+
+//==============================================================================
+AnalysisThreadPool::AnalysisThreadPool()
+    : workAvailable (std::make_unique<WakeSemaphore>())
+{
+    // Leave a core for the audio thread
+    const int numWorkers = juce::jlimit (1, kMaxWorkers, juce::SystemStats::getNumCpus() - 1);
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto worker = std::make_unique<Worker> (*this, i * kMaxClients / numWorkers);
+        if (worker->startThread (juce::Thread::Priority::normal))
+            workers.push_back (std::move (worker));
+    }
+}
+
+AnalysisThreadPool::~AnalysisThreadPool()
+{
+    for (auto& w : workers)
+        w->signalThreadShouldExit();
+
+    for (size_t i = 0; i < workers.size(); ++i)
+        workAvailable->post();
+
+    for (auto& w : workers)
+        w->stopThread (2000);
+}
+
+bool AnalysisThreadPool::add (Client* client)
+{
+    if (workers.empty())
+        return false;
+
+    const std::scoped_lock lock (registryLock);
+    for (auto& slot : slots)
+    {
+        if (slot.client.load() == nullptr)
+        {
+            slot.intervalMs.store (client->getServiceIntervalMs());
+            slot.client.store (client);
+            notify();
+            return true;
+        }
+    }
+
+    return false; // more than kMaxClients clients
+}
+
+void AnalysisThreadPool::remove (Client* client)
+{
+    const std::scoped_lock lock (registryLock);
+    for (auto& slot : slots)
+    {
+        if (slot.client.load() != client)
+            continue;
+
+        slot.client.store (nullptr);
+
+        // A worker may have picked it up just before, let it finish
+        while (slot.busy.load())
+            juce::Thread::yield();
+    }
+}
+
+void AnalysisThreadPool::notify()
+{
+    // One post wakes one worker; later calls until it's up add nothing
+    if (! wakePending.exchange (true))
+        workAvailable->post();
+}
+
+void AnalysisThreadPool::waitForWork (int timeoutMs)
+{
+    // Cleared before the next scan, so work notified after this wakes a worker again
+    if (workAvailable->wait (timeoutMs))
+        wakePending.store (false);
+}
+
+bool AnalysisThreadPool::serviceAll (int first)
+{
+    bool moreWork = false;
+    for (int i = 0; i < kMaxClients; ++i)
+    {
+        auto& slot = slots[(size_t) ((first + i) % kMaxClients)];
+        if (slot.client.load() == nullptr || slot.busy.exchange (true))
+            continue;
+
+        // Check again now that it's ours, remove() may have cleared it in between
+        if (auto* client = slot.client.load())
+        {
+            moreWork |= client->service();
+            slot.intervalMs.store (client->getServiceIntervalMs());
+        }
+
+        slot.busy.store (false);
+    }
+
+    return moreWork;
+}
+
+int AnalysisThreadPool::getWaitMs() const
+{
+    // Clients can only be touched while claimed, so this goes by what they last asked for
+    int waitMs = 100;
+    for (const auto& slot : slots)
+        if (slot.client.load() != nullptr)
+            waitMs = juce::jmin (waitMs, slot.intervalMs.load());
+    return juce::jmax (1, waitMs);
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ================================================================
+// Process-wide workers shared by every plugin instance, obtained through
+// juce::SharedResourcePointer so the last instance to go shuts them down.
+// Each instance is a Client with its own lock-free job queue; a client is
+// serviced by at most one worker at a time, so its analysis state needs no
+// locking. Every worker scans all the client slots, each starting at its own
+// offset so they don't all line up behind the same instance; there's no
+// per-worker queue to steal from. Every service() call only does a bounded
+// slice, so busy instances can't starve the rest.
+class AnalysisThreadPool
+{
+public:
+    static constexpr int kMaxClients = 256;
+    static constexpr int kMaxWorkers = 8;
+
+    class Client
+    {
+    public:
+        virtual ~Client() = default;
+
+        // Does a bounded slice of work, true when there's more waiting
+        virtual bool service() = 0;
+
+        // How soon the client wants servicing again without being notified
+        virtual int getServiceIntervalMs() const = 0;
+    };
+
+    AnalysisThreadPool();
+    ~AnalysisThreadPool();
+
+    // Message thread. remove() blocks until no worker is inside client->service().
+    // add() returns false when the client can't be serviced, because every slot
+    // is taken or no worker thread could be started.
+    bool add (Client* client);
+    void remove (Client* client);
+
+    // Any thread, never blocks: posts to a semaphore only when no wake is pending yet
+    void notify();
+
+    int getNumWorkers() const { return (int) workers.size(); }
+
+private:
+    class Worker;
+    class WakeSemaphore;
+
+    struct Slot
+    {
+        std::atomic<Client*> client { nullptr };
+        std::atomic<bool> busy { false };
+        std::atomic<int> intervalMs { 100 }; // from the client's last service()
+    };
+
+    // Services every client starting at slot first, true when any still has work
+    bool serviceAll (int first);
+    int getWaitMs() const;
+    void waitForWork (int timeoutMs);
+
+    std::array<Slot, kMaxClients> slots;
+    std::mutex registryLock; // add/remove only, workers never take it
+    std::atomic<bool> wakePending { false }; // a notify() hasn't been picked up by a worker yet
+    std::unique_ptr<WakeSemaphore> workAvailable;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    JUCE_DECLARE_NON_COPYABLE (AnalysisThreadPool)
+};
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+// ================================================================
+// Bass tunings and their fret maps.
+// String indices are 0-based from the lowest string (the notebook and the
+// SVM class labels number them from 1). A4 = 440 Hz.
+constexpr int kMaxBassStrings = 6;
+constexpr int kMaxFretLimit = 24;
+constexpr int kDefaultMaxFret = 24;
+
+struct TuningDescriptor
+{
+    const char* name;
+    const char* id; // used for per-tuning model file names
+    int numStrings;
+    std::array<int, kMaxBassStrings> openMidi; // lowest string first
+};
+
+enum TuningIndex
+{
+    tuningStandard4 = 0,
+    tuningDropD4,
+    tuningBEAD4,
+    tuningStandard5,
+    tuningStandard6,
+    kNumTunings
+};
+
+inline constexpr std::array<TuningDescriptor, kNumTunings> kTuningDescriptors { {
+    { "Standard 4 (EADG)", "standard4", 4, { 28, 33, 38, 43 } },
+    { "Drop D (DADG)", "dropd4", 4, { 26, 33, 38, 43 } },
+    { "BEAD", "bead4", 4, { 23, 28, 33, 38 } },
+    { "Standard 5 (BEADG)", "standard5", 5, { 23, 28, 33, 38, 43 } },
+    { "Standard 6 (BEADGC)", "standard6", 6, { 23, 28, 33, 38, 43, 48 } },
+} };
+
+// Fret frequencies and semitone boundaries for one tuning, precomputed so the
+// analysis path maps f0 to a fret with a short table search instead of log2.
+// Every tuning's table is a compile-time constant; switching tunings is just
+// picking another table.
+class BassTuning
+{
+public:
+    explicit constexpr BassTuning (const TuningDescriptor& d)
+        : descriptor (d)
+    {
+        // Pitches in half semitones, so the fret edges are whole steps too
+        for (int s = 0; s < kMaxBassStrings; ++s)
+        {
+            const int open = 2 * d.openMidi[(size_t) s];
+            for (int fret = 0; fret <= kMaxFretLimit; ++fret)
+                freqs[(size_t) s][(size_t) fret] = (float) halfSemitoneToHz (open + 2 * fret);
+
+            // Fret k owns [edges[k], edges[k + 1]), half a semitone either side
+            for (int k = 0; k <= kMaxFretLimit + 1; ++k)
+                edges[(size_t) s][(size_t) k] = (float) halfSemitoneToHz (open + 2 * k - 1);
+        }
+    }
+
+    constexpr const TuningDescriptor& getDescriptor() const { return descriptor; }
+    constexpr int getNumStrings() const { return descriptor.numStrings; }
+    constexpr int getOpenMidi (int stringIdx) const { return descriptor.openMidi[(size_t) stringIdx]; }
+    constexpr double getOpenFreq (int stringIdx) const { return freqs[(size_t) stringIdx][0]; }
+
+    // f_fret = f_open * 2^(fret/12)
+    constexpr double getFretFreq (int stringIdx, int fret) const { return freqs[(size_t) stringIdx][(size_t) fret]; }
+
+    // Closest fret for a measured f0 on a given string, clamped to 0..maxFret
+    int getFret (double f0, int stringIdx, int maxFret = kDefaultMaxFret) const
+    {
+        const auto& e = edges[(size_t) stringIdx];
+        const auto fret = (int) (std::upper_bound (e.begin(), e.end(), (float) f0) - e.begin()) - 1;
+        return std::clamp (fret, 0, std::min (maxFret, kMaxFretLimit));
+    }
+
+    // True when f0 lands within half a semitone of a fret 0..maxFret on this string
+    bool isPlayable (double f0, int stringIdx, int maxFret = kDefaultMaxFret) const
+    {
+        const auto& e = edges[(size_t) stringIdx];
+        return stringIdx < descriptor.numStrings
+               && f0 >= e[0]
+               && f0 < e[(size_t) std::min (maxFret, kMaxFretLimit) + 1];
+    }
+
+private:
+    // 440 * 2^((h / 2 - 69) / 12) for h in half semitones. std::exp2 isn't
+    // constexpr, so whole octaves are exact powers of two and the rest is at
+    // most 23 steps of 2^(1/24), well inside float precision.
+    static constexpr double halfSemitoneToHz (int h)
+    {
+        constexpr double kHalfSemitoneRatio = 1.0293022366434920288; // 2^(1/24)
+        int steps = h - 2 * 69;
+        double hz = 440.0;
+        for (; steps < 0; steps += 24)
+            hz *= 0.5;
+        for (; steps >= 24; steps -= 24)
+            hz *= 2.0;
+        for (; steps > 0; --steps)
+            hz *= kHalfSemitoneRatio;
+        return hz;
+    }
+
+    TuningDescriptor descriptor;
+    std::array<std::array<float, kMaxFretLimit + 1>, kMaxBassStrings> freqs {};
+    std::array<std::array<float, kMaxFretLimit + 2>, kMaxBassStrings> edges {};
+};
+
+// Immutable tables for every tuning, built at compile time
+inline constexpr std::array<BassTuning, kNumTunings> kTunings { {
+    BassTuning (kTuningDescriptors[tuningStandard4]),
+    BassTuning (kTuningDescriptors[tuningDropD4]),
+    BassTuning (kTuningDescriptors[tuningBEAD4]),
+    BassTuning (kTuningDescriptors[tuningStandard5]),
+    BassTuning (kTuningDescriptors[tuningStandard6]),
+} };
+
+constexpr const BassTuning& getTuning (int tuningIndex)
+{
+    return kTunings[(size_t) std::clamp (tuningIndex, 0, kNumTunings - 1)];
+}
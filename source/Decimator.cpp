@@ -0,0 +1,77 @@
+#include "Decimator.h"
+#include <juce_core/juce_core.h>
+#include <cmath>
+
+void Decimator::prepare (double sampleRate, double minOutputRate)
+{
+    int numStages = 0;
+    while (sampleRate / (1 << (numStages + 1)) >= minOutputRate)
+        ++numStages;
+
+    factor = 1 << numStages;
+    outputRate = sampleRate / factor;
+    latency = (kTaps / 2) * (factor - 1);
+    stages.assign ((size_t) numStages, {});
+
+    // Blackman-windowed half-band sinc: taps an even, non-zero distance from the
+    // centre are zero, the centre is 1/2. The window's zeros sit one tap beyond
+    // either end, so the outermost taps still contribute.
+    constexpr int centre = kTaps / 2;
+    for (int n = 0; n < kTaps; ++n)
+    {
+        const int k = n - centre;
+        const double sinc = k == 0 ? 0.5 : std::sin (juce::MathConstants<double>::halfPi * k) / (juce::MathConstants<double>::pi * k);
+        const double phase = juce::MathConstants<double>::twoPi * (n + 1) / (kTaps + 1);
+        const double window = 0.42 - 0.5 * std::cos (phase) + 0.08 * std::cos (2.0 * phase);
+        coeffs[(size_t) n] = (float) (sinc * window);
+    }
+}
+
+void Decimator::reset()
+{
+    for (auto& stage : stages)
+        stage = {};
+}
+
+int Decimator::process (const float* x, int numSamples, float* dest)
+{
+    int numOut = 0;
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // Each sample ripples down the cascade until a stage drops it
+        float sample = x[i];
+        bool emitted = true;
+        for (auto& stage : stages)
+        {
+            if (! push (stage, sample))
+            {
+                emitted = false;
+                break;
+            }
+        }
+
+        if (emitted)
+            dest[numOut++] = sample;
+    }
+    return numOut;
+}
+
+bool Decimator::push (Stage& stage, float& sample) const
+{
+    stage.history[(size_t) stage.pos] = stage.history[(size_t) (stage.pos + kTaps)] = sample;
+    stage.pos = stage.pos == 0 ? kTaps - 1 : stage.pos - 1;
+
+    // Only every other output is kept, so only those get computed
+    stage.skip = ! stage.skip;
+    if (! stage.skip)
+        return false;
+
+    // Symmetric taps, and those an even distance from the centre are zero apart from the centre itself
+    const float* h = stage.history.data() + stage.pos + 1;
+    float acc = coeffs[kTaps / 2] * h[kTaps / 2];
+    for (int n = 0; n < kTaps / 2; n += 2)
+        acc += coeffs[(size_t) n] * (h[n] + h[kTaps - 1 - n]);
+
+    sample = acc;
+    return true;
+}
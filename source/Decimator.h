@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+// ================================================================
+// Streaming power-of-two decimator built from cascaded half-band FIRs.
+// Bass fundamentals stay below a few hundred Hz, so f0 estimation runs on
+// this low-rate copy (around 5-6 kHz) while the harmonic tracker keeps the
+// full-bandwidth signal.
+class Decimator
+{
+public:
+    static constexpr int kTaps = 31; // per half-band stage, ~70 dB stop band
+
+    // Uses as many halvings as keep the output rate at or above minOutputRate
+    void prepare (double sampleRate, double minOutputRate);
+    void reset();
+
+    int getFactor() const { return factor; }
+    double getOutputRate() const { return outputRate; }
+
+    // Delay of the whole chain in input samples: output sample m lines up
+    // with input sample m * factor - getLatency()
+    int getLatency() const { return latency; }
+
+    // Writes at most numSamples / factor + 1 outputs to dest and returns how many
+    int process (const float* x, int numSamples, float* dest);
+
+private:
+    struct Stage
+    {
+        std::array<float, 2 * kTaps> history {}; // doubled, so the taps are always contiguous
+        int pos { 0 };
+        bool skip { false };
+    };
+
+    // Feeds one sample to a stage, true (with sample replaced) when it produces an output
+    bool push (Stage& stage, float& sample) const;
+
+    int factor { 1 };
+    int latency { 0 };
+    double outputRate { 44100.0 };
+    std::array<float, kTaps> coeffs {};
+    std::vector<Stage> stages;
+};
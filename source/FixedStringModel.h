@@ -0,0 +1,103 @@
+#pragma once
+
+#include "StringClassifier.h"
+#include <cmath>
+#include <iterator>
+
+// ================================================================
+// An RBF-SVM string model compiled into the plugin. The build turns an
+// exported model file into constexpr data for one of these
+// (tools/GenerateModelHeader.cmake, BASSAID_EMBEDDED_MODEL), so nothing is
+// parsed or allocated at startup, and feature, support vector and class
+// counts are compile-time constants the kernel loops can be unrolled over.
+// Computes the same one-vs-one decisions StringClassifier does for a loaded model.
+template <int NumFeatures, int NumSupportVectors, int NumClasses>
+struct FixedStringModel
+{
+    static_assert (NumFeatures == kNumFeatures, "the model was trained on a different feature set");
+    static_assert (NumClasses >= 2 && NumClasses <= kMaxBassStrings, "unsupported number of classes");
+
+    static constexpr int kNumPairs = NumClasses * (NumClasses - 1) / 2;
+
+    int classLabels[NumClasses]; // notebook labels, 1 = E ... 4 = G
+    int classCount[NumClasses]; // support vectors per class
+    float scalerMean[NumFeatures];
+    float scalerScale[NumFeatures];
+    float imputerMedians[NumFeatures];
+    float gamma;
+    float supportVectors[NumSupportVectors][NumFeatures]; // scaled space
+    float dualCoef[NumClasses - 1][NumSupportVectors];
+    float intercept[kNumPairs];
+    float probA[kNumPairs]; // Platt scaling, all zero without probabilities
+    float probB[kNumPairs];
+    bool hasProbabilities;
+
+    // Decision value of every OvO pair (libsvm order) whose classes are both candidates
+    void computeDecisions (const StringFeatures& features, const bool* isCandidate, float* decisions) const
+    {
+        float scaled[NumFeatures];
+        for (int f = 0; f < NumFeatures; ++f)
+        {
+            const float v = std::isfinite (features[(size_t) f]) ? features[(size_t) f] : imputerMedians[f];
+            scaled[f] = (v - scalerMean[f]) / scalerScale[f];
+        }
+
+        int classStart[NumClasses];
+        float kernel[NumSupportVectors];
+        for (int c = 0, start = 0; c < NumClasses; start += classCount[c++])
+        {
+            classStart[c] = start;
+            if (! isCandidate[c])
+                continue;
+
+            for (int sv = start; sv < start + classCount[c]; ++sv)
+            {
+                float dist = 0.0f;
+                for (int f = 0; f < NumFeatures; ++f)
+                {
+                    const float d = scaled[f] - supportVectors[sv][f];
+                    dist += d * d;
+                }
+                kernel[sv] = std::exp (-gamma * dist);
+            }
+        }
+
+        int p = 0;
+        for (int i = 0; i < NumClasses; ++i)
+        {
+            for (int j = i + 1; j < NumClasses; ++j, ++p)
+            {
+                if (! isCandidate[i] || ! isCandidate[j])
+                    continue;
+
+                float decision = intercept[p];
+                for (int k = classStart[i]; k < classStart[i] + classCount[i]; ++k)
+                    decision += dualCoef[j - 1][k] * kernel[k];
+                for (int k = classStart[j]; k < classStart[j] + classCount[j]; ++k)
+                    decision += dualCoef[i][k] * kernel[k];
+                decisions[p] = decision;
+            }
+        }
+    }
+};
+
+// Wraps a compiled-in model so it can fill a StringModelSlots slot
+template <const auto& Model>
+std::shared_ptr<const StringModel> makeFixedStringModel()
+{
+    auto m = std::make_shared<StringModel>();
+    m->numFeatures = kNumFeatures;
+    m->classLabels.assign (std::begin (Model.classLabels), std::end (Model.classLabels));
+    m->numClasses = (int) m->classLabels.size();
+
+    if (Model.hasProbabilities)
+    {
+        m->probA.assign (std::begin (Model.probA), std::end (Model.probA));
+        m->probB.assign (std::begin (Model.probB), std::end (Model.probB));
+    }
+
+    m->fixedDecisions = [] (const StringFeatures& features, const bool* isCandidate, float* decisions) {
+        Model.computeDecisions (features, isCandidate, decisions);
+    };
+    return m;
+}
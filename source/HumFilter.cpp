@@ -0,0 +1,149 @@
+#include "HumFilter.h"
+#include <cmath>
+
+namespace
+{
+    constexpr float kNotchBandwidthHz = 2.0f; // wide enough for mains drift, narrow enough to spare B1 next to 60 Hz
+    constexpr double kDetectWindowSeconds = 0.2; // whole cycles of both 50 and 60 Hz
+    constexpr double kDetectFraction = 0.5; // share of the quiet signal's energy that has to be hum
+    constexpr double kReleaseFraction = 0.1;
+    constexpr int kReleaseWindows = 10; // 2 s without hum before bypassing again
+    constexpr double kMinHumPower = 1.0e-10; // -100 dBFS, digital silence has no hum to remove
+} // namespace
+
+void HumFilter::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    windowLength = (int) std::round (kDetectWindowSeconds * sampleRate);
+
+    for (int family = 0; family < 2; ++family)
+        for (int p = 0; p < kNumProbes; ++p)
+        {
+            const double hz = (family == 0 ? 50.0 : 60.0) * (double) (p + 1);
+            probeCoeff[(size_t) (family * kNumProbes + p)] = 2.0 * std::cos (juce::MathConstants<double>::twoPi * hz / sampleRate);
+        }
+
+    reset();
+}
+
+void HumFilter::reset()
+{
+    mains = 0;
+    humFreeWindows = 0;
+    restartDetection();
+}
+
+void HumFilter::process (float* x, int numSamples, bool quiet)
+{
+    // Detection looks at the raw input, and only between notes
+    if (quiet)
+        detect (x, numSamples);
+    else if (windowPos > 0)
+        restartDetection();
+
+    if (mains <= 0)
+        return;
+
+    const auto two = Vec::expand (2.0f);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto v0 = Vec::expand (x[i]);
+        auto band = Vec::expand (0.0f);
+
+        for (size_t g = 0; g < (size_t) kNumGroups; ++g)
+        {
+            const auto v3 = v0 - ic2[g];
+            const auto v1 = a1[g] * ic1[g] + a2[g] * v3;
+            const auto v2 = ic2[g] + a2[g] * ic1[g] + a3[g] * v3;
+            ic1[g] = two * v1 - ic1[g];
+            ic2[g] = two * v2 - ic2[g];
+            band += k[g] * v1;
+        }
+
+        x[i] -= band.sum();
+    }
+}
+
+//==============================================================================
+void HumFilter::detect (const float* x, int numSamples)
+{
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const double xi = x[i];
+        windowEnergy += xi * xi;
+
+        for (size_t p = 0; p < probeCoeff.size(); ++p)
+        {
+            const double s = xi + probeCoeff[p] * probeS1[p] - probeS2[p];
+            probeS2[p] = probeS1[p];
+            probeS1[p] = s;
+        }
+
+        if (++windowPos == windowLength)
+            finishDetectionWindow();
+    }
+}
+
+void HumFilter::restartDetection()
+{
+    probeS1.fill (0.0);
+    probeS2.fill (0.0);
+    windowEnergy = 0.0;
+    windowPos = 0;
+}
+
+void HumFilter::finishDetectionWindow()
+{
+    double familyPower[2] {};
+    for (size_t p = 0; p < probeCoeff.size(); ++p)
+        familyPower[p / kNumProbes] += probeS1[p] * probeS1[p] + probeS2[p] * probeS2[p] - probeCoeff[p] * probeS1[p] * probeS2[p];
+
+    // Scaled so a pure tone on a probe scores 1
+    const double norm = 0.5 * (double) windowLength * windowEnergy;
+    const bool silent = windowEnergy / (double) windowLength < kMinHumPower;
+    restartDetection();
+
+    const int family = familyPower[1] > familyPower[0] ? 1 : 0;
+    const double fraction = silent ? 0.0 : familyPower[family] / norm;
+
+    if (fraction > kDetectFraction)
+    {
+        setMains (family == 0 ? 50 : 60);
+        humFreeWindows = 0;
+    }
+    else if (fraction < kReleaseFraction && ++humFreeWindows >= kReleaseWindows)
+    {
+        setMains (0);
+    }
+}
+
+void HumFilter::setMains (int hz)
+{
+    if (hz == mains)
+        return;
+
+    mains = hz;
+    if (mains <= 0)
+        return;
+
+    for (int n = 0; n < kNumNotches; ++n)
+    {
+        const auto group = (size_t) n / Vec::SIMDNumElements;
+        const auto lane = (size_t) n % Vec::SIMDNumElements;
+
+        // Notches that would land near Nyquist are left out (zero gain)
+        const double f = (double) (mains * (n + 1));
+        const bool active = f < 0.45 * sampleRate;
+        const double g = std::tan (juce::MathConstants<double>::pi * juce::jmin (f, 0.45 * sampleRate) / sampleRate);
+        const double damping = kNotchBandwidthHz / f; // 1 / Q
+        const double c1 = 1.0 / (1.0 + g * (g + damping));
+
+        a1[group].set (lane, (float) c1);
+        a2[group].set (lane, (float) (g * c1));
+        a3[group].set (lane, (float) (g * g * c1));
+        k[group].set (lane, active ? (float) damping : 0.0f);
+    }
+
+    for (size_t g = 0; g < (size_t) kNumGroups; ++g)
+        ic1[g] = ic2[g] = Vec::expand (0.0f);
+}
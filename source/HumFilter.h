@@ -0,0 +1,51 @@
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+
+// ================================================================
+// Mains hum rejection for the analysis signal.
+// While the input is quiet, Goertzel probes on the 50 and 60 Hz harmonic
+// series decide whether hum is present and at which mains frequency. Once
+// found, a bank of narrow notches at the fundamental and its harmonics
+// removes it. The notches run in parallel (y = x - sum of unity-gain
+// band-passes), one per SIMD lane. Without hum the bank is bypassed.
+class HumFilter
+{
+public:
+    static constexpr int kNumNotches = 8; // mains fundamental and 7 harmonics
+
+    void prepare (double sampleRate);
+    void reset();
+
+    // In place. quiet should be true when no note is playing, so detection
+    // measures the noise floor rather than the bass.
+    void process (float* x, int numSamples, bool quiet);
+
+    // 50 or 60 once hum has been found, 0 while bypassed
+    int getMainsFrequency() const { return mains; }
+
+private:
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr int kNumGroups = kNumNotches / (int) Vec::SIMDNumElements;
+    static_assert (kNumNotches % (int) Vec::SIMDNumElements == 0, "notches must fill whole SIMD registers");
+
+    void detect (const float* x, int numSamples);
+    void restartDetection();
+    void finishDetectionWindow();
+    void setMains (int hz);
+
+    double sampleRate { 44100.0 };
+    int mains { 0 }; // Hz, whole so it compares exactly
+
+    // Topology-preserving SVF band-passes, one notch per lane
+    std::array<Vec, kNumGroups> a1, a2, a3, k, ic1, ic2;
+
+    // Goertzel probes on the first harmonics of 50 Hz, then of 60 Hz
+    static constexpr int kNumProbes = 4;
+    std::array<double, 2 * kNumProbes> probeCoeff {}, probeS1 {}, probeS2 {};
+    double windowEnergy { 0.0 };
+    int windowPos { 0 };
+    int windowLength { 0 };
+    int humFreeWindows { 0 };
+};
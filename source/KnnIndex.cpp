@@ -0,0 +1,193 @@
+#include "KnnIndex.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace
+{
+    constexpr int kMaxDepth = 64; // of the traversal stack, far beyond any balanced tree
+} // namespace
+
+void KnnIndex::build (const float* samples, const int* classIndices, int numSamples)
+{
+    features.assign (samples, samples + (size_t) numSamples * kNumFeatures);
+    classes.assign (classIndices, classIndices + numSamples);
+    rebuild();
+}
+
+void KnnIndex::append (const float* sample, int classIndex)
+{
+    features.insert (features.end(), sample, sample + kNumFeatures);
+    classes.push_back (classIndex);
+
+    // Scanned linearly until the tail costs about as much as a few more levels of tree
+    const int tail = getNumSamples() - numIndexed;
+    if (tail > juce::jmax (4 * kLeafSize, numIndexed / 4))
+    {
+        rebuild();
+        return;
+    }
+
+    const auto zero = Vec::expand (0.0f);
+    for (int g = 0; g < kNumGroups; ++g)
+    {
+        auto v = zero;
+        for (size_t lane = 0; lane < Vec::SIMDNumElements && g * (int) Vec::SIMDNumElements + (int) lane < kNumFeatures; ++lane)
+            v.set (lane, sample[(size_t) g * Vec::SIMDNumElements + lane]);
+        rows.push_back (v);
+    }
+}
+
+void KnnIndex::rebuild()
+{
+    const int numSamples = getNumSamples();
+    std::vector<int> order ((size_t) numSamples);
+    std::iota (order.begin(), order.end(), 0);
+
+    nodes.clear();
+    if (numSamples > 0)
+        buildNode (order, 0, numSamples);
+
+    // Samples in leaf order, so every leaf is one contiguous run
+    std::vector<float> sortedFeatures (features.size());
+    std::vector<int> sortedClasses (classes.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        std::copy_n (features.begin() + (long) order[i] * kNumFeatures, kNumFeatures, sortedFeatures.begin() + (long) i * kNumFeatures);
+        sortedClasses[i] = classes[(size_t) order[i]];
+    }
+    features = std::move (sortedFeatures);
+    classes = std::move (sortedClasses);
+
+    const auto zero = Vec::expand (0.0f);
+    rows.assign ((size_t) numSamples * kNumGroups, zero);
+    for (size_t i = 0; i < (size_t) numSamples; ++i)
+        for (size_t f = 0; f < (size_t) kNumFeatures; ++f)
+            rows[i * kNumGroups + f / Vec::SIMDNumElements].set (f % Vec::SIMDNumElements, features[i * kNumFeatures + f]);
+
+    numIndexed = numSamples;
+}
+
+int KnnIndex::buildNode (std::vector<int>& order, int begin, int end)
+{
+    const int index = (int) nodes.size();
+    nodes.push_back ({});
+
+    if (end - begin <= kLeafSize)
+    {
+        nodes[(size_t) index].first = begin;
+        nodes[(size_t) index].second = end;
+        return index;
+    }
+
+    // Split the widest axis at its median
+    const auto value = [&] (int sample, int axis) { return features[(size_t) sample * kNumFeatures + (size_t) axis]; };
+    int axis = 0;
+    float widest = -1.0f;
+    for (int f = 0; f < kNumFeatures; ++f)
+    {
+        float lo = std::numeric_limits<float>::max(), hi = -lo;
+        for (int i = begin; i < end; ++i)
+        {
+            lo = juce::jmin (lo, value (order[(size_t) i], f));
+            hi = juce::jmax (hi, value (order[(size_t) i], f));
+        }
+
+        if (hi - lo > widest)
+        {
+            widest = hi - lo;
+            axis = f;
+        }
+    }
+
+    const int mid = (begin + end) / 2;
+    std::nth_element (order.begin() + begin, order.begin() + mid, order.begin() + end,
+        [&] (int a, int b) { return value (a, axis) < value (b, axis); });
+
+    const float split = value (order[(size_t) mid], axis);
+    const int left = buildNode (order, begin, mid);
+    const int right = buildNode (order, mid, end);
+
+    auto& node = nodes[(size_t) index];
+    node.axis = axis;
+    node.split = split;
+    node.first = left;
+    node.second = right;
+    return index;
+}
+
+int KnnIndex::search (const float* query, int k, const bool* isCandidate, Neighbour* dest) const
+{
+    k = juce::jlimit (1, kMaxNeighbours, k);
+
+    std::array<Vec, kNumGroups> q;
+    q.fill (Vec::expand (0.0f));
+    for (size_t f = 0; f < (size_t) kNumFeatures; ++f)
+        q[f / Vec::SIMDNumElements].set (f % Vec::SIMDNumElements, query[f]);
+
+    int numFound = 0;
+
+    struct Pending
+    {
+        int node;
+        float bound; // no sample below it can be closer than this
+    };
+
+    std::array<Pending, kMaxDepth> stack;
+    int depth = 0;
+    if (! nodes.empty())
+        stack[(size_t) depth++] = { 0, 0.0f };
+
+    while (depth > 0)
+    {
+        const auto pending = stack[(size_t) --depth];
+        if (numFound == k && pending.bound >= dest[k - 1].distance)
+            continue;
+
+        const auto& node = nodes[(size_t) pending.node];
+        if (node.axis < 0)
+        {
+            scan (q.data(), node.first, node.second, k, isCandidate, dest, numFound);
+            continue;
+        }
+
+        // Nearer side first; the far one only matters while the split plane is within the k-th distance
+        const float diff = query[node.axis] - node.split;
+        jassert (depth + 2 <= kMaxDepth);
+        stack[(size_t) depth++] = { diff < 0.0f ? node.second : node.first, juce::jmax (pending.bound, diff * diff) };
+        stack[(size_t) depth++] = { diff < 0.0f ? node.first : node.second, pending.bound };
+    }
+
+    // Samples appended since the last build
+    scan (q.data(), numIndexed, getNumSamples(), k, isCandidate, dest, numFound);
+    return numFound;
+}
+
+void KnnIndex::scan (const Vec* query, int begin, int end, int k, const bool* isCandidate, Neighbour* dest, int& numFound) const
+{
+    const auto zero = Vec::expand (0.0f);
+    for (int i = begin; i < end; ++i)
+    {
+        const int c = classes[(size_t) i];
+        if (! isCandidate[c])
+            continue;
+
+        const auto* row = rows.data() + (size_t) i * kNumGroups;
+        auto acc = zero;
+        for (int g = 0; g < kNumGroups; ++g)
+        {
+            const auto d = query[g] - row[g];
+            acc = Vec::multiplyAdd (acc, d, d);
+        }
+
+        const float distance = acc.sum();
+        if (numFound == k && distance >= dest[k - 1].distance)
+            continue;
+
+        // Insertion into the sorted neighbours, k is small
+        int j = numFound < k ? numFound++ : k - 1;
+        for (; j > 0 && dest[j - 1].distance > distance; --j)
+            dest[j] = dest[j - 1];
+        dest[j] = { distance, c };
+    }
+}
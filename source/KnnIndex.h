@@ -0,0 +1,62 @@
+#pragma once
+
+#include "SpectrumAnalyser.h"
+#include <juce_dsp/juce_dsp.h>
+
+#include <array>
+#include <vector>
+
+// ================================================================
+// Exact k nearest neighbours over training samples in the model's scaled
+// feature space. A KD-tree laid out flat: nodes in one array with children
+// by index, and samples reordered so every leaf is a contiguous run of rows,
+// each padded to whole SIMD registers and scanned a register at a time.
+// Subtrees farther than the current k-th neighbour are skipped, so a query
+// visits a logarithmic number of leaves on typical data.
+// Samples appended after building go to an unindexed tail that every query
+// scans too, until it's big enough to be worth rebuilding the tree over.
+// Nothing allocates in search().
+class KnnIndex
+{
+public:
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr int kNumGroups = (kNumFeatures + (int) Vec::SIMDNumElements - 1) / (int) Vec::SIMDNumElements;
+    static constexpr int kMaxNeighbours = 16;
+    static constexpr int kLeafSize = 16;
+
+    struct Neighbour
+    {
+        float distance { 0.0f }; // squared
+        int classIndex { -1 };
+    };
+
+    // samples is numSamples x kNumFeatures, row-major
+    void build (const float* samples, const int* classIndices, int numSamples);
+    void append (const float* sample, int classIndex);
+
+    int getNumSamples() const { return (int) classes.size(); }
+    int getNumIndexed() const { return numIndexed; }
+
+    // The k nearest samples of the classes flagged in isCandidate, nearest first.
+    // Returns how many were found, fewer than k when the candidates have fewer samples.
+    int search (const float* query, int k, const bool* isCandidate, Neighbour* dest) const;
+
+private:
+    struct Node
+    {
+        int axis { -1 }; // -1 for a leaf
+        float split { 0.0f };
+        int first { 0 }; // a leaf's rows, or the children of an inner node
+        int second { 0 };
+    };
+
+    void rebuild();
+    int buildNode (std::vector<int>& order, int begin, int end);
+    void scan (const Vec* query, int begin, int end, int k, const bool* isCandidate, Neighbour* dest, int& numFound) const;
+
+    std::vector<float> features; // numSamples x kNumFeatures, for splitting
+    std::vector<Vec> rows; // numSamples x kNumGroups, zero padded
+    std::vector<int> classes;
+    std::vector<Node> nodes; // root first
+    int numIndexed { 0 };
+};
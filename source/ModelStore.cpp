@@ -0,0 +1,168 @@
+#include "ModelStore.h"
+
+#include <juce_events/juce_events.h>
+
+#include <algorithm>
+
+StringModelStore::StringModelStore()
+{
+    live = std::make_unique<const Snapshot> (Snapshot { loadDefaultModels(), 1 });
+    current.store (live.get());
+}
+
+StringModelStore::~StringModelStore()
+{
+    // Every reader has gone by now, so whatever is still retired can go too
+    if (loader != nullptr)
+        loader->removeAllJobs (true, 5000);
+}
+
+//==============================================================================
+int StringModelStore::addReader()
+{
+    const std::scoped_lock lock (writerLock);
+    for (int r = 0; r < kMaxReaders; ++r)
+    {
+        if (! readerUsed[(size_t) r])
+        {
+            readerUsed[(size_t) r] = true;
+            return r;
+        }
+    }
+
+    return -1;
+}
+
+void StringModelStore::removeReader (int reader)
+{
+    const std::scoped_lock lock (writerLock);
+    if (reader < 0)
+        return;
+
+    readerEpochs[(size_t) reader].store (0);
+    readerUsed[(size_t) reader] = false;
+}
+
+StringModelStore::ReadScope::ReadScope (StringModelStore& store, int reader)
+    : readerEpoch (store.readerEpochs[(size_t) reader])
+{
+    // Announce the epoch before loading the pointer: a set replaced after this
+    // load is tagged with a later epoch, so it stays alive until we leave
+    readerEpoch.store (store.epoch.load());
+    snapshot = store.current.load();
+}
+
+StringModelStore::ReadScope::~ReadScope()
+{
+    readerEpoch.store (0);
+}
+
+//==============================================================================
+void StringModelStore::publish (int tuningIndex, std::shared_ptr<const StringModel> model)
+{
+    {
+        const std::scoped_lock lock (writerLock);
+
+        // Built completely before any reader can see it
+        auto next = std::make_unique<Snapshot> (*live);
+        const auto slot = (size_t) juce::jlimit (0, kNumTunings - 1, tuningIndex);
+        next->models[slot] = std::move (model);
+        sources[slot] = juce::File(); // until loadAsync() says where it came from
+        overrides[slot] = juce::File();
+        ++next->version;
+
+        current.store (next.get());
+        retired.push_back ({ std::move (live), epoch.fetch_add (1) + 1 });
+        live = std::move (next);
+    }
+
+    reclaim();
+}
+
+StringModelSlots StringModelStore::copyModels()
+{
+    const std::scoped_lock lock (writerLock);
+    return live->models;
+}
+
+bool StringModelStore::reclaim()
+{
+    const std::scoped_lock lock (writerLock);
+
+    // Oldest epoch a reader may have entered with
+    uint64_t oldestReader = epoch.load();
+    for (const auto& e : readerEpochs)
+        if (const auto readerEpoch = e.load(); readerEpoch != 0)
+            oldestReader = juce::jmin (oldestReader, readerEpoch);
+
+    retired.erase (std::remove_if (retired.begin(), retired.end(), [&] (const Retired& r) { return r.epoch <= oldestReader; }),
+        retired.end());
+
+    return retired.empty();
+}
+
+bool StringModelStore::isLoadedFrom (int tuningIndex, const juce::File& file)
+{
+    const std::scoped_lock lock (writerLock);
+    return sources[(size_t) juce::jlimit (0, kNumTunings - 1, tuningIndex)] == file;
+}
+
+juce::File StringModelStore::getOverride (int tuningIndex)
+{
+    const std::scoped_lock lock (writerLock);
+    return overrides[(size_t) juce::jlimit (0, kNumTunings - 1, tuningIndex)];
+}
+
+void StringModelStore::loadAsync (int tuningIndex, const juce::File& file, std::function<void (const juce::String& error)> onLoaded)
+{
+    tuningIndex = juce::jlimit (0, kNumTunings - 1, tuningIndex);
+    {
+        const std::scoped_lock lock (writerLock);
+        overrides[(size_t) tuningIndex] = file;
+    }
+
+    if (loader == nullptr)
+        loader = std::make_unique<juce::ThreadPool> (1);
+
+    loader->addJob ([this, tuningIndex, file, onLoaded = std::move (onLoaded)] {
+        if (isLoadedFrom (tuningIndex, file))
+        {
+            if (onLoaded != nullptr)
+                juce::MessageManager::callAsync ([onLoaded] { onLoaded ({}); });
+            return;
+        }
+
+        juce::String error;
+        auto model = StringModel::fromFile (file, error);
+
+        if (model != nullptr && ! model->fitsTuning (getTuning (tuningIndex)))
+        {
+            error = "Model has more strings than " + juce::String (kTuningDescriptors[(size_t) tuningIndex].name);
+            model = nullptr;
+        }
+
+        if (model != nullptr)
+        {
+            publish (tuningIndex, std::move (model));
+            {
+                const std::scoped_lock lock (writerLock);
+                sources[(size_t) tuningIndex] = file;
+                overrides[(size_t) tuningIndex] = file;
+            }
+
+            // Readers only pin a set for one analysis slice, so this is quick
+            for (int i = 0; i < 200 && ! reclaim(); ++i)
+                juce::Thread::sleep (5);
+        }
+        else
+        {
+            // The previous model stays live, so does its file, unless another load was asked for meanwhile
+            const std::scoped_lock lock (writerLock);
+            if (overrides[(size_t) tuningIndex] == file)
+                overrides[(size_t) tuningIndex] = sources[(size_t) tuningIndex];
+        }
+
+        if (onLoaded != nullptr)
+            juce::MessageManager::callAsync ([onLoaded, error] { onLoaded (error); });
+    });
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "StringClassifier.h"
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// ================================================================
+// Process-wide home for the string models, held through
+// juce::SharedResourcePointer: the first plugin instance loads the default
+// models, later ones share them and the last one to go frees them.
+//
+// Models can be replaced while playing. A new set is built off to the side
+// and published with one atomic pointer swap, so a reader sees either the
+// old set or the new one. Replaced sets are freed (epoch-based) once every
+// reader that could still see them has left its read scope, always on the
+// thread doing the replacing, never on a reader.
+class StringModelStore
+{
+    struct Snapshot;
+
+public:
+    static constexpr int kMaxReaders = 256;
+
+    StringModelStore();
+    ~StringModelStore();
+
+    // Message thread. Each analysis context that reads models needs its own slot;
+    // -1 once all kMaxReaders are taken.
+    int addReader();
+    void removeReader (int reader);
+
+    // Pins the current models until it goes out of scope. Wait-free, any thread.
+    class ReadScope
+    {
+    public:
+        ReadScope (StringModelStore& store, int reader);
+        ~ReadScope();
+
+        const StringModelSlots& getModels() const { return snapshot->models; }
+
+        // Changes with every publish(), unlike the address of getModels()
+        uint64_t getVersion() const { return snapshot->version; }
+
+    private:
+        std::atomic<uint64_t>& readerEpoch;
+        const Snapshot* snapshot;
+
+        JUCE_DECLARE_NON_COPYABLE (ReadScope)
+    };
+
+    // The current models, kept alive by the copy, for a context without a reader
+    // slot. Later publishes don't reach it. Message thread.
+    StringModelSlots copyModels();
+
+    // Replaces one tuning's model (nullptr for the fallback) and clears its override.
+    // Not for the audio or analysis threads.
+    void publish (int tuningIndex, std::shared_ptr<const StringModel> model);
+
+    // Reads and checks the model on the store's loader thread, then publishes it.
+    // onLoaded gets the error, empty on success, on the message thread. A file
+    // that's already the tuning's model isn't read again, so dozens of
+    // instances restoring the same override only load it once.
+    // Message thread; the loader thread is only started by the first call.
+    void loadAsync (int tuningIndex, const juce::File& file, std::function<void (const juce::String& error)> onLoaded);
+
+    // The file a tuning's model was last replaced from through loadAsync(), or
+    // File() for the default. It's set as soon as a load is asked for and goes
+    // back to the live model's file if that load fails. Overrides apply to the
+    // whole process, so every instance saves them in its state.
+    juce::File getOverride (int tuningIndex);
+
+    // Frees the replaced sets no reader can still see, true when none are left
+    bool reclaim();
+
+private:
+    bool isLoadedFrom (int tuningIndex, const juce::File& file);
+
+    struct Snapshot
+    {
+        StringModelSlots models;
+        uint64_t version { 0 };
+    };
+
+    struct Retired
+    {
+        std::unique_ptr<const Snapshot> snapshot;
+        uint64_t epoch { 0 }; // safe once no reader entered before this
+    };
+
+    std::atomic<const Snapshot*> current { nullptr };
+    std::atomic<uint64_t> epoch { 1 };
+    std::array<std::atomic<uint64_t>, kMaxReaders> readerEpochs {}; // 0 when outside a ReadScope
+
+    std::mutex writerLock; // everything below, never taken by readers
+    std::unique_ptr<const Snapshot> live;
+    std::vector<Retired> retired;
+    std::array<bool, kMaxReaders> readerUsed {};
+    std::array<juce::File, kNumTunings> sources; // where each tuning's live model was loaded from, if it was
+    std::array<juce::File, kNumTunings> overrides; // what loadAsync() was last asked for, see getOverride()
+
+    std::unique_ptr<juce::ThreadPool> loader; // only started once something is loaded
+
+    JUCE_DECLARE_NON_COPYABLE (StringModelStore)
+};
@@ -0,0 +1,172 @@
+#include "MultiPitchEstimator.h"
+#include <cmath>
+
+namespace
+{
+    constexpr int kSalienceHarmonics = 10;
+    constexpr int kGridStepsPerOctave = 48; // quarter-semitone grid
+
+    // Partial weighting from Klapuri (2006), favours the true f0 over its sub-octaves
+    inline float partialWeight (float f0, int n)
+    {
+        return (f0 + 27.0f) / ((float) n * f0 + 320.0f);
+    }
+} // namespace
+
+void MultiPitchEstimator::prepare (const SpectrumAnalyser& spectrum, const AnalysisConfig& config)
+{
+    residual.assign ((size_t) spectrum.getNumBins(), 0.0f);
+
+    const int numSteps = (int) std::ceil ((float) kGridStepsPerOctave * std::log2 (config.fMax / config.fMin)) + 1;
+    candidates.resize ((size_t) numSteps);
+    for (int i = 0; i < numSteps; ++i)
+        candidates[(size_t) i] = config.fMin * std::exp2 ((float) i / (float) kGridStepsPerOctave);
+
+    // Half-width of a Hann main lobe is two bins of the unpadded frame
+    const int windowSamples = juce::jmax (1, config.getWindowSamples (spectrum.getSampleRate()));
+    const double fftSize = spectrum.getSampleRate() / spectrum.getBinHz();
+    lobeBins = juce::jmax (2, (int) std::ceil (2.0 * fftSize / windowSamples));
+}
+
+float MultiPitchEstimator::salience (const SpectrumAnalyser& spectrum, float f0) const
+{
+    const double binHz = spectrum.getBinHz();
+    const int numBins = (int) residual.size();
+    float sum = 0.0f;
+
+    for (int n = 1; n <= kSalienceHarmonics; ++n)
+    {
+        const double targetBin = (double) n * (double) f0 / binHz;
+        if (targetBin >= (double) (numBins - 2))
+            break;
+
+        // Just wide enough to cover the grid spacing and some β stretch. Only local
+        // maxima count, otherwise candidates near a strong partial feed off its skirt.
+        const int k = (int) std::lround (targetBin);
+        const int width = 1 + (int) (0.008 * targetBin);
+        float peak = 0.0f;
+        for (int b = juce::jmax (1, k - width), e = juce::jmin (numBins - 2, k + width); b <= e; ++b)
+        {
+            const float m = residual[(size_t) b];
+            if (m > peak && m >= residual[(size_t) b - 1] && m >= residual[(size_t) b + 1])
+                peak = m;
+        }
+
+        sum += partialWeight (f0, n) * peak;
+    }
+
+    return sum;
+}
+
+void MultiPitchEstimator::cancel (const SpectrumAnalyser& spectrum, const HarmonicSet& harmonics)
+{
+    const double binHz = spectrum.getBinHz();
+    const int numBins = (int) residual.size();
+
+    for (int i = 0; i < harmonics.count; ++i)
+    {
+        const float fn = harmonics.freqs[(size_t) i];
+        if (! std::isfinite (fn) || fn <= 0.0f)
+            continue;
+
+        // Spectral smoothness: only remove what the neighbouring partials predict,
+        // so a partial shared with another note keeps that note's share
+        float neighbours = harmonics.amps[(size_t) i];
+        int count = 1;
+        if (i > 0)
+        {
+            neighbours += harmonics.amps[(size_t) i - 1];
+            ++count;
+        }
+        if (i + 1 < harmonics.count)
+        {
+            neighbours += harmonics.amps[(size_t) i + 1];
+            ++count;
+        }
+        const float amp = juce::jmin (harmonics.amps[(size_t) i], neighbours / (float) count);
+
+        const double centre = fn / binHz;
+        const int k0 = juce::jmax (0, (int) std::floor (centre) - lobeBins);
+        const int k1 = juce::jmin (numBins - 1, (int) std::ceil (centre) + lobeBins);
+        for (int k = k0; k <= k1; ++k)
+        {
+            const double d = std::abs (k - centre) / lobeBins;
+            if (d >= 1.0)
+                continue;
+
+            const float shape = (float) (0.5 + 0.5 * std::cos (juce::MathConstants<double>::pi * d));
+            residual[(size_t) k] = juce::jmax (0.0f, residual[(size_t) k] - amp * shape);
+        }
+    }
+}
+
+int MultiPitchEstimator::estimate (const SpectrumAnalyser& spectrum,
+    const AnalysisConfig& config,
+    PitchCandidate* dest,
+    int maxVoices)
+{
+    std::copy_n (spectrum.getMagnitudes(), residual.size(), residual.begin());
+
+    const int numHarmonics = juce::jmax (config.numHarmonics, kSalienceHarmonics);
+    float firstSalience = 0.0f;
+    int found = 0;
+
+    // Every pass cancels one voice, duplicates included, so this is bounded
+    for (int pass = 0; pass < 2 * maxVoices && found < maxVoices; ++pass)
+    {
+        float bestF0 = 0.0f, best = 0.0f;
+        for (auto f : candidates)
+        {
+            const float s = salience (spectrum, f);
+            if (s > best)
+            {
+                best = s;
+                bestF0 = f;
+            }
+        }
+
+        if (best <= 1e-6f || (found > 0 && best < config.voiceSalienceRatio * firstSalience))
+            break;
+
+        // Refine on the measured low partials, which are barely stretched by β.
+        // Weighting by n offsets the 1/n roll-off: a partial's frequency error from
+        // overlapping lobes shrinks by 1/n once divided down to f0.
+        const int numTracked = juce::jmin (numHarmonics, kMaxHarmonics);
+        const auto coarse = spectrum.trackHarmonics (bestF0, numTracked, residual.data());
+        double num = 0.0, den = 0.0;
+        for (int i = 0; i < juce::jmin (6, coarse.count); ++i)
+        {
+            const float fn = coarse.freqs[(size_t) i];
+            if (std::isfinite (fn) && fn > 0.0f)
+            {
+                const double w = (double) coarse.amps[(size_t) i] * (double) (i + 1);
+                num += w * (double) fn / (double) (i + 1);
+                den += w;
+            }
+        }
+        const float f0 = den > 0.0 ? (float) (num / den) : bestF0;
+        const auto harmonics = spectrum.trackHarmonics (f0, numTracked, residual.data());
+
+        // A voice within a semitone of an earlier one is just its leftover energy
+        bool duplicate = false;
+        for (int v = 0; v < found; ++v)
+            duplicate |= std::abs (12.0f * std::log2 (f0 / dest[v].f0)) < 1.0f;
+
+        cancel (spectrum, harmonics);
+
+        if (duplicate)
+            continue;
+
+        if (found == 0)
+            firstSalience = best;
+
+        // Features only use the first numHarmonics partials, like the mono path
+        dest[found].f0 = f0;
+        dest[found].salience = best;
+        dest[found].harmonics = harmonics;
+        dest[found].harmonics.count = juce::jmin (harmonics.count, config.numHarmonics);
+        ++found;
+    }
+
+    return found;
+}
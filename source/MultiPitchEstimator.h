@@ -0,0 +1,33 @@
+#pragma once
+
+#include "AnalysisConfig.h"
+#include "SpectrumAnalyser.h"
+#include <vector>
+
+// ================================================================
+// Multi-f0 estimation by iterative harmonic cancellation (Klapuri-style).
+// Works entirely on the magnitude spectrum the harmonic tracker already
+// computed, so double stops cost one FFT plus a few cheap salience sweeps.
+struct PitchCandidate
+{
+    float f0 { 0.0f };
+    float salience { 0.0f };
+    HarmonicSet harmonics; // partials measured before this voice was cancelled
+};
+
+class MultiPitchEstimator
+{
+public:
+    void prepare (const SpectrumAnalyser& spectrum, const AnalysisConfig& config);
+
+    // Fills up to maxVoices candidates, strongest first. Returns how many were found.
+    int estimate (const SpectrumAnalyser& spectrum, const AnalysisConfig& config, PitchCandidate* dest, int maxVoices);
+
+private:
+    float salience (const SpectrumAnalyser& spectrum, float f0) const;
+    void cancel (const SpectrumAnalyser& spectrum, const HarmonicSet& harmonics);
+
+    std::vector<float> residual;
+    std::vector<float> candidates; // log-spaced f0 grid
+    int lobeBins { 8 };
+};
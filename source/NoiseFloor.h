@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+// ================================================================
+// Adaptive noise-floor estimate of a live input.
+// The floor follows the signal envelope straight down, but only creeps up
+// slowly, so it settles on the quietest recent level (amp hiss, hum, pickup
+// noise) instead of on the notes themselves.
+class NoiseFloor
+{
+public:
+    void prepare (double sampleRate)
+    {
+        envCoeff = (float) (1.0 - std::exp (-1.0 / (0.010 * sampleRate)));
+        fallCoeff = (float) (1.0 - std::exp (-1.0 / (0.100 * sampleRate)));
+        riseFactor = (float) std::pow (10.0, kRiseDbPerSecond / 20.0 / sampleRate);
+        reset();
+    }
+
+    void reset()
+    {
+        level = 0.0f;
+        floor = kInitialFloor;
+    }
+
+    void process (const float* x, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            level += envCoeff * (std::abs (x[i]) - level);
+
+            if (level < floor)
+                floor += fallCoeff * (level - floor);
+            else
+                floor *= riseFactor;
+        }
+        floor = std::max (floor, kMinFloor);
+    }
+
+    float getFloor() const { return floor; }
+    float getLevel() const { return level; }
+
+    // Nothing much above the floor, e.g. between notes
+    bool isQuiet() const { return level < floor * kQuietRatio; }
+
+private:
+    static constexpr float kRiseDbPerSecond = 3.0f;
+    static constexpr float kInitialFloor = 1.0e-4f; // -80 dBFS
+    static constexpr float kMinFloor = 1.0e-6f;
+    static constexpr float kQuietRatio = 2.0f; // +6 dB
+
+    float level { 0.0f }, floor { kInitialFloor };
+    float envCoeff { 0.0f }, fallCoeff { 0.0f }, riseFactor { 1.0f };
+};
@@ -0,0 +1,256 @@
+#include "NoteAnalyser.h"
+#include "OctaveCorrection.h"
+#include <algorithm>
+#include <cmath>
+
+void NoteAnalyser::prepare (double newSampleRate, const AnalysisConfig& newConfig, int decimation)
+{
+    sampleRate = newSampleRate;
+    config = newConfig;
+
+    const int windowSamples = config.getWindowSamples (sampleRate);
+    const double lowRate = sampleRate / decimation;
+    const int lowRateWindow = windowSamples / decimation + 1;
+    spectrum.prepare (sampleRate, windowSamples, config.zeroPad);
+
+    yin.prepare (sampleRate, windowSamples, config.fMin, config.fMax, &pitchScratch);
+    lowRateYin.prepare (lowRate, lowRateWindow, config.fMin, config.fMax, &pitchScratch);
+    lowRatePyramid.prepare (lowRate, lowRateWindow, config.fMin, config.fMax);
+    mpm.prepare (sampleRate, windowSamples, config.fMin, config.fMax, &pitchScratch);
+    lowRateMpm.prepare (lowRate, lowRateWindow, config.fMin, config.fMax, &pitchScratch);
+    hps.prepare (sampleRate, spectrum.getNumBins(), windowSamples, config.fMin, config.fMax, &pitchScratch);
+    multiPitch.prepare (spectrum, config);
+}
+
+void NoteAnalyser::setModels (const StringModelSlots& models)
+{
+    // Every slot keeps its own scratch, so switching tunings never allocates
+    for (size_t i = 0; i < classifiers.size(); ++i)
+        classifiers[i].setModel (models[i].get());
+}
+
+int NoteAnalyser::analyse (const float* frame, int numSamples, const AnalysisSettings& settings, NoteEvent* dest,
+                           const float* lowRateFrame, int numLowRate)
+{
+    begin (frame, numSamples, settings, lowRateFrame, numLowRate);
+
+    bool done = false;
+    while (! done)
+        done = step (dest);
+
+    return job.numVoices;
+}
+
+void NoteAnalyser::begin (const float* frame, int numSamples, const AnalysisSettings& settings,
+                          const float* lowRateFrame, int numLowRate)
+{
+    job = {};
+    job.frame = frame;
+    job.numSamples = numSamples;
+    job.lowRateFrame = lowRateFrame;
+    job.numLowRate = numLowRate;
+    job.settings = settings;
+    job.settings.maxVoices = juce::jlimit (1, kMaxVoices, settings.maxVoices);
+    job.stage = Stage::spectrum;
+}
+
+bool NoteAnalyser::step (NoteEvent* dest)
+{
+    switch (job.stage)
+    {
+        case Stage::spectrum:
+            // One FFT per note, shared by harmonic tracking and every multi-f0 candidate
+            spectrum.compute (job.frame, job.numSamples);
+            job.stage = Stage::pitch;
+            return false;
+
+        case Stage::pitch:
+            job.numVoices = estimateVoices();
+            job.stage = Stage::classify;
+            return false;
+
+        case Stage::classify:
+            if (job.nextVoice < job.numVoices)
+                classifyVoice (job.nextVoice++, dest);
+
+            if (job.nextVoice < job.numVoices)
+                return false;
+
+            assignStrings (job.numVoices, job.settings, dest);
+            job.stage = Stage::done;
+            return true;
+
+        case Stage::done:
+            break;
+    }
+
+    return true;
+}
+
+int NoteAnalyser::estimateVoices()
+{
+    if (job.settings.maxVoices > 1)
+        return multiPitch.estimate (spectrum, config, voices.data(), job.settings.maxVoices);
+
+    float f0 = estimateF0 (job.frame, job.numSamples, job.lowRateFrame, job.numLowRate);
+    if (config.octaveCorrection)
+        f0 = correctOctave (spectrum, f0, getTuning (job.settings.tuning), job.settings.maxFret, config.octaveSwitchRatio);
+
+    if (f0 < config.fMin || f0 > config.fMax)
+        return 0;
+
+    voices[0].f0 = f0;
+    voices[0].harmonics = spectrum.trackHarmonics (f0, config.numHarmonics);
+    return 1;
+}
+
+void NoteAnalyser::classifyVoice (int v, NoteEvent* dest)
+{
+    const auto& settings = job.settings;
+    auto& classifier = classifiers[(size_t) juce::jlimit (0, kNumTunings - 1, settings.tuning)];
+
+    const auto& voice = voices[(size_t) v];
+    const auto features = buildFeatures (voice.harmonics, voice.f0, spectrum.getShape(), sampleRate, config.numHarmonics);
+    const auto prediction = classifier.predict (features, getTuning (settings.tuning), settings.maxFret);
+
+    auto& e = dest[v];
+    e = {};
+    e.tuning = settings.tuning;
+    e.f0 = voice.f0;
+    e.voice = v;
+    e.numVoices = job.numVoices;
+    e.stringProbs = prediction.probs;
+    e.stringIdx = prediction.stringIdx;
+}
+
+float NoteAnalyser::estimateF0 (const float* frame, int numSamples, const float* lowRateFrame, int numLowRate)
+{
+    switch (config.pitchBackend)
+    {
+        case PitchBackend::hps:
+            return hps.estimate (spectrum.getMagnitudes());
+
+        case PitchBackend::mpm:
+            return lowRateFrame != nullptr ? lowRateMpm.estimate (lowRateFrame, numLowRate, config.yinThreshold)
+                                           : mpm.estimate (frame, numSamples, config.yinThreshold);
+
+        case PitchBackend::yin:
+            break;
+    }
+
+    if (lowRateFrame == nullptr)
+        return yin.estimate (frame, numSamples, config.yinThreshold);
+
+    if (config.pitchSearch == PitchSearch::pyramid)
+        return lowRatePyramid.estimate (lowRateFrame, numLowRate, config.yinThreshold);
+
+    return lowRateYin.estimate (lowRateFrame, numLowRate, config.yinThreshold);
+}
+
+void NoteAnalyser::assignStrings (int numVoices, const AnalysisSettings& settings, NoteEvent* dest) const
+{
+    if (numVoices <= 0)
+        return;
+
+    const auto& tuning = getTuning (settings.tuning);
+
+    // At most 6^3 combinations, cheap enough to search exhaustively
+    int best[kMaxVoices] { -1, -1, -1 };
+    int current[kMaxVoices] {};
+    double bestScore = -1.0e30;
+
+    const auto search = [&] (auto& self, int v, double score) -> void {
+        if (v == numVoices)
+        {
+            if (score > bestScore)
+            {
+                bestScore = score;
+                std::copy_n (current, numVoices, best);
+            }
+            return;
+        }
+
+        for (int s = 0; s < tuning.getNumStrings(); ++s)
+        {
+            bool taken = false;
+            for (int u = 0; u < v; ++u)
+                taken |= current[u] == s;
+
+            if (taken || ! tuning.isPlayable (dest[v].f0, s, settings.maxFret))
+                continue;
+
+            current[v] = s;
+            self (self, v + 1, score + std::log (juce::jmax (dest[v].stringProbs[(size_t) s], 1e-6f)));
+        }
+    };
+    search (search, 0, 0.0);
+
+    for (int v = 0; v < numVoices; ++v)
+    {
+        auto& e = dest[v];
+        if (best[v] >= 0)
+            e.stringIdx = best[v];
+
+        if (e.stringIdx < 0)
+            continue;
+
+        e.fret = tuning.getFret (e.f0, e.stringIdx, settings.maxFret);
+        e.confidence = e.stringProbs[(size_t) e.stringIdx];
+    }
+}
+
+//==============================================================================
+void FrameVote::add (const NoteEvent& frame)
+{
+    if (frame.isValid() && frame.numVoices == 1 && numFrames < kMaxFrames)
+        frames[(size_t) numFrames++] = frame;
+}
+
+NoteEvent FrameVote::getResult (int maxFret) const
+{
+    if (numFrames == 0)
+        return {};
+
+    auto result = frames[0];
+    const auto& tuning = getTuning (result.tuning);
+
+    std::array<float, kMaxFrames> f0s {};
+    for (int i = 0; i < numFrames; ++i)
+        f0s[(size_t) i] = frames[(size_t) i].f0;
+    std::sort (f0s.begin(), f0s.begin() + numFrames);
+    result.f0 = f0s[(size_t) numFrames / 2];
+
+    // Mean log-probability per string, then back to probabilities
+    std::array<double, kMaxBassStrings> logProbs {};
+    double bestLog = -1.0e30;
+    for (int s = 0; s < tuning.getNumStrings(); ++s)
+    {
+        if (! tuning.isPlayable (result.f0, s, maxFret))
+            continue;
+
+        for (int i = 0; i < numFrames; ++i)
+            logProbs[(size_t) s] += std::log ((double) juce::jmax (frames[(size_t) i].stringProbs[(size_t) s], 1e-6f)) / (double) numFrames;
+
+        if (logProbs[(size_t) s] > bestLog)
+        {
+            bestLog = logProbs[(size_t) s];
+            result.stringIdx = s;
+        }
+    }
+
+    if (bestLog <= -1.0e30)
+        return frames[0];
+
+    double total = 0.0;
+    result.stringProbs = {};
+    for (int s = 0; s < tuning.getNumStrings(); ++s)
+        if (tuning.isPlayable (result.f0, s, maxFret))
+            total += result.stringProbs[(size_t) s] = (float) std::exp (logProbs[(size_t) s] - bestLog);
+
+    for (auto& p : result.stringProbs)
+        p = (float) (p / total);
+
+    result.fret = tuning.getFret (result.f0, result.stringIdx, maxFret);
+    result.confidence = result.stringProbs[(size_t) result.stringIdx];
+    return result;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "AnalysisConfig.h"
+#include "MultiPitchEstimator.h"
+#include "NoteEvent.h"
+#include "PitchDetection.h"
+#include "SpectrumAnalyser.h"
+#include "StringClassifier.h"
+
+#include <array>
+
+// ================================================================
+// One note in, (string, fret) out: f0 -> one FFT -> octave check -> harmonics/β features
+// -> string classifier -> fret. Mirrors RealTimeStringFretEstimator from
+// the notebook. Not thread-safe, each worker owns its own instance.
+class NoteAnalyser
+{
+public:
+    // decimation is the factor between sampleRate and the low-rate f0 frames
+    // that can be handed to analyse(), 1 when there are none
+    void prepare (double sampleRate, const AnalysisConfig& config, int decimation = 1);
+
+    // The models aren't copied, the caller keeps them alive while analysing
+    void setModels (const StringModelSlots& models);
+
+    // frame is the post-attack sustain window. Writes up to kMaxVoices events
+    // (fewer than settings.maxVoices when fewer notes are found) and returns the count.
+    // lowRateFrame, when given, is the same window decimated; single-note f0
+    // is estimated on it, the spectrum always uses the full-rate frame.
+    int analyse (const float* frame, int numSamples, const AnalysisSettings& settings, NoteEvent* dest,
+                 const float* lowRateFrame = nullptr, int numLowRate = 0);
+
+    // The same analysis cut into bounded steps, for running inline on the audio thread.
+    // begin() takes the frames, which have to stay put until it's done; each step()
+    // does one stage (FFT, f0, then one voice's features and classification) and
+    // returns true once dest holds getNumVoices() events.
+    void begin (const float* frame, int numSamples, const AnalysisSettings& settings,
+                const float* lowRateFrame = nullptr, int numLowRate = 0);
+    bool step (NoteEvent* dest);
+    int getNumVoices() const { return job.numVoices; }
+
+private:
+    enum class Stage
+    {
+        spectrum,
+        pitch,
+        classify,
+        done
+    };
+
+    struct Job
+    {
+        const float* frame { nullptr };
+        int numSamples { 0 };
+        const float* lowRateFrame { nullptr };
+        int numLowRate { 0 };
+        AnalysisSettings settings;
+        Stage stage { Stage::done };
+        int numVoices { 0 };
+        int nextVoice { 0 };
+    };
+
+    int estimateVoices();
+    void classifyVoice (int v, NoteEvent* dest);
+    float estimateF0 (const float* frame, int numSamples, const float* lowRateFrame, int numLowRate);
+
+    // Picks distinct, playable strings for all voices maximising the joint probability
+    void assignStrings (int numVoices, const AnalysisSettings& settings, NoteEvent* dest) const;
+
+    double sampleRate { 44100.0 };
+    AnalysisConfig config;
+
+    // Full-rate and low-rate estimators, all on one scratch arena
+    PitchScratch pitchScratch;
+    YinPitchDetector yin;
+    YinPitchDetector lowRateYin;
+    PyramidPitchDetector lowRatePyramid;
+    McLeodPitchDetector mpm;
+    McLeodPitchDetector lowRateMpm;
+    HpsPitchDetector hps;
+    SpectrumAnalyser spectrum;
+    MultiPitchEstimator multiPitch;
+    std::array<StringClassifier, kNumTunings> classifiers; // one per tuning's model slot
+    std::array<PitchCandidate, kMaxVoices> voices;
+    Job job;
+};
+
+// ================================================================
+// Combines one single note's analyses over several frames: string
+// log-probabilities add up, f0 is the median and the fret follows from both.
+class FrameVote
+{
+public:
+    static constexpr int kMaxFrames = 4;
+
+    void reset() { numFrames = 0; }
+    void add (const NoteEvent& frame); // valid single-voice results only, the rest is ignored
+    int getNumFrames() const { return numFrames; }
+
+    // The first frame's event with the voted string, fret, f0 and probabilities
+    NoteEvent getResult (int maxFret) const;
+
+private:
+    std::array<NoteEvent, kMaxFrames> frames;
+    int numFrames { 0 };
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "BassTuning.h"
+#include <array>
+#include <cstdint>
+
+// ================================================================
+// One detected note, handed from the analysis thread to the UI.
+// Plain data so it can travel through a lock-free FIFO.
+struct NoteEvent
+{
+    int tuning { tuningStandard4 };
+    int stringIdx { -1 }; // 0 = lowest string
+    int fret { -1 };
+    float f0 { 0.0f };
+    float confidence { 0.0f }; // probability of the chosen string
+    int voice { 0 }; // 0 for single notes, 0..2 for double stops / chords
+    int numVoices { 1 };
+    int64_t onsetSample { 0 }; // for legato notes, where the pitch change was confirmed
+    bool legato { false }; // found by the tracker rather than a pluck
+    int input { 0 }; // which of the plugin's analysed inputs played it
+    bool provisional { false }; // first-frame guess, the final event with the same onsetSample follows
+    std::array<float, kMaxBassStrings> stringProbs {};
+
+    bool isValid() const { return stringIdx >= 0 && fret >= 0; }
+};
@@ -0,0 +1,75 @@
+#include "OctaveCorrection.h"
+#include <cmath>
+
+namespace
+{
+    constexpr int kScoredPartials = 8;
+    constexpr float kPartialDecay = 0.7f; // weight of partial n is kPartialDecay^(n - 1)
+
+    bool isPlayableAnywhere (float f0, const BassTuning& tuning, int maxFret)
+    {
+        for (int s = 0; s < tuning.getNumStrings(); ++s)
+            if (tuning.isPlayable (f0, s, maxFret))
+                return true;
+        return false;
+    }
+
+    // Weighted sum of the partials of f0 that show up as actual peaks. A
+    // sub-octave only collects every other partial of the real note, and an
+    // octave above misses all the odd ones, so the true f0 scores highest.
+    float harmonicSupport (const SpectrumAnalyser& spectrum, float f0)
+    {
+        const float* mags = spectrum.getMagnitudes();
+        const int numBins = spectrum.getNumBins();
+        const double binHz = spectrum.getBinHz();
+
+        float sum = 0.0f, weight = 1.0f;
+        for (int n = 1; n <= kScoredPartials; ++n, weight *= kPartialDecay)
+        {
+            const double targetBin = (double) n * (double) f0 / binHz;
+            if (targetBin >= (double) (numBins - 2))
+                break;
+
+            // Wide enough for some β stretch; only local maxima count, so a
+            // missing partial next to a strong one doesn't feed off its skirt
+            const int k = (int) std::lround (targetBin);
+            const int width = 1 + (int) (0.015 * targetBin);
+            float peak = 0.0f;
+            for (int b = juce::jmax (1, k - width), e = juce::jmin (numBins - 2, k + width); b <= e; ++b)
+                if (mags[b] > peak && mags[b] >= mags[b - 1] && mags[b] >= mags[b + 1])
+                    peak = mags[b];
+
+            sum += weight * peak;
+        }
+
+        return sum;
+    }
+} // namespace
+
+float correctOctave (const SpectrumAnalyser& spectrum, float f0, const BassTuning& tuning, int maxFret, float switchRatio)
+{
+    if (f0 <= 0.0f)
+        return f0;
+
+    const bool estimatePlayable = isPlayableAnywhere (f0, tuning, maxFret);
+    const float estimateScore = estimatePlayable ? harmonicSupport (spectrum, f0) : 0.0f;
+
+    float best = f0;
+    float bestScore = estimateScore * switchRatio;
+    bool found = estimatePlayable;
+    for (const float candidate : { 0.5f * f0, 2.0f * f0 })
+    {
+        if (! isPlayableAnywhere (candidate, tuning, maxFret))
+            continue;
+
+        const float score = harmonicSupport (spectrum, candidate);
+        if (! found || score > bestScore)
+        {
+            best = candidate;
+            bestScore = score;
+            found = true;
+        }
+    }
+
+    return best;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "BassTuning.h"
+#include "SpectrumAnalyser.h"
+
+// ================================================================
+// Fretboard-constrained octave correction for single notes.
+// An octave error from the f0 estimator often lands on a pitch no string
+// can play. Of f0, f0 / 2 and 2 f0 only candidates with a playable
+// (string, fret) under the tuning and max fret are kept, and the one whose
+// partials the already computed spectrum supports best wins. The estimator's
+// own f0 has to be beaten by switchRatio, unless it isn't playable at all.
+float correctOctave (const SpectrumAnalyser& spectrum, float f0, const BassTuning& tuning, int maxFret, float switchRatio);
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cmath>
+
+// ================================================================
+// Cheap envelope-ratio onset detector for plucked notes.
+// A fast peak envelope jumping well above a slow average of it marks a new attack;
+// a hold-off plus re-arming only once the envelopes have crossed back
+// stops one pluck from triggering twice.
+class OnsetDetector
+{
+public:
+    static constexpr int kMaxOnsetsPerBlock = 4;
+
+    void prepare (double sampleRate, int holdOffSamples)
+    {
+        fastAttack = coeff (sampleRate, 0.001);
+        fastRelease = coeff (sampleRate, 0.030);
+        slowCoeff = coeff (sampleRate, 0.150);
+        holdOff = holdOffSamples;
+        reset();
+    }
+
+    void reset()
+    {
+        fastEnv = slowEnv = 0.0f;
+        samplesSinceOnset = holdOff;
+        armed = true;
+    }
+
+    void setThreshold (float linearThreshold) { threshold = linearThreshold; }
+
+    // Writes sample offsets of onsets within the block, returns how many
+    int process (const float* x, int numSamples, int* onsets)
+    {
+        int numOnsets = 0;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float a = std::abs (x[i]);
+            fastEnv += (a > fastEnv ? fastAttack : fastRelease) * (a - fastEnv);
+            slowEnv += slowCoeff * (fastEnv - slowEnv); // of the peak envelope, so a steady tone sits at 1:1
+
+            // The slow envelope takes a while to catch up with a loud pluck
+            const bool rising = fastEnv > ratio * slowEnv;
+            armed |= ! rising;
+
+            if (samplesSinceOnset < holdOff)
+            {
+                ++samplesSinceOnset;
+                continue;
+            }
+
+            if (armed && rising && fastEnv > threshold && numOnsets < kMaxOnsetsPerBlock)
+            {
+                onsets[numOnsets++] = i;
+                samplesSinceOnset = 0;
+                armed = false;
+            }
+        }
+        return numOnsets;
+    }
+
+private:
+    static float coeff (double sampleRate, double seconds)
+    {
+        return (float) (1.0 - std::exp (-1.0 / (seconds * sampleRate)));
+    }
+
+    float fastEnv { 0.0f }, slowEnv { 0.0f };
+    float fastAttack { 0.0f }, fastRelease { 0.0f }, slowCoeff { 0.0f };
+    float threshold { 0.01f }; // about -40 dBFS
+    float ratio { 2.0f };
+    int holdOff { 0 };
+    int samplesSinceOnset { 0 };
+    bool armed { true };
+};
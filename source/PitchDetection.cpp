@@ -0,0 +1,476 @@
+#include "PitchDetection.h"
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+namespace
+{
+    // Removes DC and applies a symmetric Hann window, returns the windowed energy of x[j..n) in tailEnergy
+    void prepareFrame (const float* frame, int n, float* dest, double* tailEnergy)
+    {
+        double mean = 0.0;
+        for (int i = 0; i < n; ++i)
+            mean += frame[i];
+        mean /= n;
+
+        const double w = 2.0 * std::numbers::pi / (n - 1);
+        for (int i = 0; i < n; ++i)
+            dest[i] = (float) ((frame[i] - mean) * (0.5 - 0.5 * std::cos (w * i)));
+
+        tailEnergy[n] = 0.0;
+        for (int i = n; --i >= 0;)
+            tailEnergy[i] = tailEnergy[i + 1] + (double) dest[i] * dest[i];
+    }
+
+    // d(tau) = sum_j (x[j] - x[j + tau])^2 with x zero beyond n; the tail energy keeps that O(overlap)
+    double differenceAt (const float* x, int n, int tau, const double* tailEnergy)
+    {
+        const int overlap = std::max (0, n - tau);
+        float acc = 0.0f;
+        for (int j = 0; j < overlap; ++j)
+        {
+            const float delta = x[j] - x[j + tau];
+            acc += delta * delta;
+        }
+        return acc + tailEnergy[overlap];
+    }
+
+    // Cumulative mean normalised difference over [1, maxTau]
+    void cumulativeMeanNormalise (const double* diff, int maxTau, double* cmndf)
+    {
+        cmndf[0] = 1.0;
+        double running = 0.0;
+        for (int tau = 1; tau <= maxTau; ++tau)
+        {
+            running += diff[tau];
+            cmndf[tau] = running > 0.0 ? diff[tau] * tau / running : 1.0;
+        }
+    }
+} // namespace
+
+void PitchScratch::reserve (int frameLength, int numLags)
+{
+    const auto grow = [] (auto& v, int size) {
+        if ((int) v.size() < size)
+            v.assign ((size_t) size, {});
+    };
+
+    grow (frame, frameLength);
+    grow (energy, frameLength + 1);
+    grow (lag, numLags);
+    grow (normalised, numLags);
+}
+
+//==============================================================================
+void YinPitchDetector::prepare (double newSampleRate, int maxFrameLength, float fMin, float fMax, PitchScratch* scratch)
+{
+    sampleRate = newSampleRate;
+    maxFrame = maxFrameLength;
+    maxTau = (int) (sampleRate / fMin);
+    minTau = std::max (1, (int) (sampleRate / fMax));
+
+    sharedScratch = scratch;
+    getScratch().reserve (maxFrame, maxTau + 1);
+}
+
+float YinPitchDetector::estimate (const float* frame, int numSamples, float threshold)
+{
+    const int n = std::min (numSamples, maxFrame);
+    lastAperiodicity = 1.0f;
+
+    // Need at least ~20 ms to be sane
+    if (n < (int) (sampleRate * 0.02))
+        return 0.0f;
+
+    auto& s = getScratch();
+    float* buffer = s.frame.data();
+    double* diff = s.lag.data();
+    double* cmndf = s.normalised.data();
+
+    // Remove DC and apply a (symmetric) Hann window to reduce leakage
+    prepareFrame (frame, n, buffer, s.energy.data());
+
+    for (int tau = 1; tau <= maxTau; ++tau)
+        diff[tau] = differenceAt (buffer, n, tau, s.energy.data());
+
+    cumulativeMeanNormalise (diff, maxTau, cmndf);
+
+    // First dip below threshold (followed down to its local minimum), else global minimum
+    int tau = -1;
+    for (int t = minTau; t <= maxTau; ++t)
+    {
+        if (cmndf[t] < threshold)
+        {
+            while (t + 1 <= maxTau && cmndf[t + 1] < cmndf[t])
+                ++t;
+            tau = t;
+            break;
+        }
+    }
+
+    if (tau < 0)
+        tau = (int) (std::min_element (cmndf + minTau, cmndf + maxTau + 1) - cmndf);
+
+    lastAperiodicity = (float) cmndf[tau];
+
+    // Parabolic refinement for a sub-sample period
+    double period = tau;
+    if (tau > 1 && tau < maxTau)
+    {
+        const double a = cmndf[tau - 1], b = cmndf[tau], c = cmndf[tau + 1];
+        const double denom = (a - 2.0 * b + c) + 1e-12;
+        period += 0.5 * (a - c) / denom;
+    }
+
+    return (float) (sampleRate / std::max (period, 1e-6));
+}
+
+//==============================================================================
+void PyramidPitchDetector::prepare (double newSampleRate, int maxFrameLength, float fMin, float fMax)
+{
+    sampleRate = newSampleRate;
+    maxFrame = maxFrameLength;
+    maxTau = (int) (sampleRate / fMin);
+    minTau = std::max (1, (int) (sampleRate / fMax));
+    coarseMinTau = std::max (1, minTau / kCoarseFactor - 1);
+    coarseMaxTau = maxTau / kCoarseFactor + 1;
+
+    buffer.assign ((size_t) maxFrame, 0.0f);
+    raw.assign ((size_t) maxFrame, 0.0f);
+    tailEnergy.assign ((size_t) maxFrame + 1, 0.0);
+    coarse.assign ((size_t) maxFrame / kCoarseFactor + 1, 0.0f);
+    coarseTailEnergy.assign (coarse.size() + 1, 0.0);
+    coarseDiff.assign ((size_t) coarseMaxTau + 1, 0.0);
+    coarseCmndf.assign ((size_t) coarseMaxTau + 1, 0.0);
+}
+
+float PyramidPitchDetector::estimate (const float* frame, int numSamples, float threshold)
+{
+    const int n = std::min (numSamples, maxFrame);
+    lastAperiodicity = 1.0f;
+
+    if (n < (int) (sampleRate * 0.02))
+        return 0.0f;
+
+    prepareFrame (frame, n, buffer.data(), tailEnergy.data());
+
+    double mean = 0.0;
+    for (int i = 0; i < n; ++i)
+        mean += frame[i];
+    mean /= n;
+
+    for (int i = 0; i < n; ++i)
+        raw[(size_t) i] = (float) (frame[i] - mean);
+
+    // Coarse level: short triangular low-pass, every kCoarseFactor-th sample
+    constexpr float taps[] = { 1.0f, 2.0f, 3.0f, 4.0f, 3.0f, 2.0f, 1.0f };
+    const int numCoarse = n / kCoarseFactor;
+    for (int i = 0; i < numCoarse; ++i)
+    {
+        float acc = 0.0f;
+        for (int k = -3; k <= 3; ++k)
+        {
+            const int j = i * kCoarseFactor + k;
+            if (j >= 0 && j < n)
+                acc += taps[k + 3] * buffer[(size_t) j];
+        }
+        coarse[(size_t) i] = acc * (1.0f / 16.0f);
+    }
+
+    coarseTailEnergy[(size_t) numCoarse] = 0.0;
+    for (int i = numCoarse; --i >= 0;)
+        coarseTailEnergy[(size_t) i] = coarseTailEnergy[(size_t) i + 1] + (double) coarse[(size_t) i] * coarse[(size_t) i];
+
+    for (int tau = 1; tau <= coarseMaxTau; ++tau)
+        coarseDiff[(size_t) tau] = differenceAt (coarse.data(), numCoarse, tau, coarseTailEnergy.data());
+
+    cumulativeMeanNormalise (coarseDiff.data(), coarseMaxTau, coarseCmndf.data());
+
+    // Candidate periods: the coarse dips, shortest lag first (like YIN's first-dip rule)
+    int candidates[kMaxCandidates];
+    int numCandidates = 0;
+    for (int t = coarseMinTau; t < coarseMaxTau && numCandidates < kMaxCandidates; ++t)
+        if (coarseCmndf[(size_t) t] < kCoarseThreshold && coarseCmndf[(size_t) t] <= coarseCmndf[(size_t) t - 1]
+            && coarseCmndf[(size_t) t] < coarseCmndf[(size_t) t + 1])
+            candidates[numCandidates++] = t;
+
+    if (numCandidates == 0)
+        candidates[numCandidates++] = (int) (std::min_element (coarseCmndf.begin() + coarseMinTau, coarseCmndf.end()) - coarseCmndf.begin());
+
+    // Fine level: the normalised difference of the unwindowed frame, only in a band around each candidate
+    // (the Hann window would make two periods at the far ends of a long lag look unalike)
+    const auto normalisedAt = [&] (int tau) {
+        float d = 0.0f, energy = 0.0f;
+        for (int j = 0; j < n - tau; ++j)
+        {
+            const float delta = raw[(size_t) j] - raw[(size_t) (j + tau)];
+            d += delta * delta;
+            energy += raw[(size_t) j] * raw[(size_t) j] + raw[(size_t) (j + tau)] * raw[(size_t) (j + tau)];
+        }
+        return energy > 0.0f ? (double) (d / energy) : 1.0;
+    };
+
+    int bestTau = -1;
+    double bestValue = 2.0;
+    for (int c = 0; c < numCandidates; ++c)
+    {
+        const int centre = candidates[c] * kCoarseFactor;
+        const int lo = std::max (minTau, centre - kFineRadius);
+        const int hi = std::min (maxTau, centre + kFineRadius);
+
+        int tau = -1;
+        double value = 2.0;
+        for (int t = lo; t <= hi; ++t)
+        {
+            const double v = normalisedAt (t);
+            if (v < value)
+            {
+                value = v;
+                tau = t;
+            }
+        }
+
+        // The shortest period that's periodic enough wins, otherwise the most periodic one
+        if (tau >= 0 && value < threshold)
+        {
+            bestTau = tau;
+            bestValue = value;
+            break;
+        }
+
+        if (value < bestValue)
+        {
+            bestTau = tau;
+            bestValue = value;
+        }
+    }
+
+    if (bestTau < 0)
+        return 0.0f;
+
+    lastAperiodicity = (float) bestValue;
+
+    // Parabolic refinement, same as the full search
+    double period = bestTau;
+    if (bestTau > 1 && bestTau < maxTau)
+    {
+        const double a = normalisedAt (bestTau - 1), b = bestValue, c = normalisedAt (bestTau + 1);
+        const double denom = (a - 2.0 * b + c) + 1e-12;
+        period += 0.5 * (a - c) / denom;
+    }
+
+    return (float) (sampleRate / std::max (period, 1e-6));
+}
+
+//==============================================================================
+void McLeodPitchDetector::prepare (double newSampleRate, int maxFrameLength, float fMin, float fMax, PitchScratch* scratch)
+{
+    sampleRate = newSampleRate;
+    maxFrame = maxFrameLength;
+    maxTau = (int) (sampleRate / fMin);
+    minTau = std::max (1, (int) (sampleRate / fMax));
+
+    sharedScratch = scratch;
+    getScratch().reserve (maxFrame, maxTau + 2);
+}
+
+float McLeodPitchDetector::estimate (const float* frame, int numSamples, float threshold)
+{
+    const int n = std::min (numSamples, maxFrame);
+    lastAperiodicity = 1.0f;
+
+    if (n < (int) (sampleRate * 0.02))
+        return 0.0f;
+
+    auto& s = getScratch();
+    float* x = s.frame.data();
+    double* nsdf = s.lag.data();
+
+    double mean = 0.0;
+    for (int i = 0; i < n; ++i)
+        mean += frame[i];
+    mean /= n;
+
+    double m = 0.0;
+    for (int i = 0; i < n; ++i)
+    {
+        x[i] = (float) (frame[i] - mean);
+        m += 2.0 * (double) x[i] * x[i];
+    }
+
+    // m(tau) = sum_j x[j]^2 + x[j + tau]^2 over the overlap loses one square from each end per lag
+    const int lastTau = std::min (maxTau + 1, n - 1);
+    for (int tau = 1; tau <= lastTau; ++tau)
+    {
+        m -= (double) x[tau - 1] * x[tau - 1] + (double) x[n - tau] * x[n - tau];
+
+        float r = 0.0f;
+        for (int j = 0; j < n - tau; ++j)
+            r += x[j] * x[j + tau];
+        nsdf[tau] = m > 1e-12 ? 2.0 * r / m : 0.0;
+    }
+
+    // Key maxima: the peak of every positive lobe after the one around tau = 0
+    constexpr int kMaxKeys = 32;
+    int keys[kMaxKeys];
+    int numKeys = 0;
+
+    int t = 1;
+    while (t <= lastTau && nsdf[t] > 0.0)
+        ++t;
+
+    int peak = -1;
+    for (; t <= lastTau + 1 && numKeys < kMaxKeys; ++t)
+    {
+        if (t <= lastTau && nsdf[t] > 0.0)
+        {
+            if (peak < 0 || nsdf[t] > nsdf[peak])
+                peak = t;
+        }
+        else if (peak >= 0)
+        {
+            if (peak >= minTau && peak <= maxTau)
+                keys[numKeys++] = peak;
+            peak = -1;
+        }
+    }
+
+    if (numKeys == 0)
+        return 0.0f;
+
+    double highest = 0.0;
+    for (int k = 0; k < numKeys; ++k)
+        highest = std::max (highest, nsdf[keys[k]]);
+
+    int tau = keys[0];
+    for (int k = 0; k < numKeys; ++k)
+    {
+        if (nsdf[keys[k]] >= (1.0 - threshold) * highest)
+        {
+            tau = keys[k];
+            break;
+        }
+    }
+
+    lastAperiodicity = (float) (1.0 - nsdf[tau]);
+
+    double period = tau;
+    if (tau > 1 && tau < lastTau)
+    {
+        const double a = nsdf[tau - 1], b = nsdf[tau], c = nsdf[tau + 1];
+        const double denom = (a - 2.0 * b + c) - 1e-12;
+        period += 0.5 * (a - c) / denom;
+    }
+
+    return (float) (sampleRate / std::max (period, 1e-6));
+}
+
+//==============================================================================
+void HpsPitchDetector::prepare (double sampleRate, int newNumBins, int frameLength, float fMin, float fMax, PitchScratch* scratch)
+{
+    numBins = newNumBins;
+    binHz = sampleRate / (2.0 * (numBins - 1));
+    minBin = std::max (1, (int) std::floor (fMin / binHz));
+    maxBin = std::min ((numBins - 1) / kNumProducts, (int) std::ceil (fMax / binHz));
+
+    // Half-width of a Hann main lobe, 2 / T
+    lobeBins = std::max (1, (int) std::ceil (2.0 * sampleRate / std::max (1, frameLength) / binHz));
+
+    sharedScratch = scratch;
+    getScratch().reserve (0, numBins);
+}
+
+float HpsPitchDetector::estimate (const float* mags)
+{
+    lastAperiodicity = 1.0f;
+    if (maxBin <= minBin)
+        return 0.0f;
+
+    // Log magnitudes, so the product neither underflows nor gets dominated by one partial
+    constexpr double kFloor = 1e-9;
+    double* logMag = getScratch().lag.data();
+    double peakMag = 0.0;
+    for (int k = 0; k < numBins; ++k)
+    {
+        logMag[k] = std::log (mags[k] + kFloor);
+        peakMag = std::max (peakMag, (double) mags[k]);
+    }
+
+    if (peakMag <= kFloor)
+        return 0.0f;
+
+    const auto product = [&] (int k) {
+        double sum = 0.0;
+        for (int h = 1; h <= kNumProducts; ++h)
+            sum += logMag[h * k];
+        return sum;
+    };
+
+    int best = minBin;
+    double bestScore = product (minBin);
+    for (int k = minBin + 1; k <= maxBin; ++k)
+    {
+        const double score = product (k);
+        if (score > bestScore)
+        {
+            best = k;
+            bestScore = score;
+        }
+    }
+
+    // Octave below: take it when its product is within kOctaveRatio of the winner
+    constexpr double kOctaveRatio = 0.2;
+    int lower = -1;
+    double lowerScore = -1.0e300;
+    for (int k = best / 2 - 1; k <= best / 2 + 1; ++k)
+    {
+        if (k >= minBin && product (k) > lowerScore)
+        {
+            lower = k;
+            lowerScore = product (k);
+        }
+    }
+
+    // ...and when there's an actual (weak) fundamental there, not just the skirt of the next partial
+    const auto isPeak = [&] (int k) { return k > 0 && k < numBins - 1 && mags[k] >= mags[k - 1] && mags[k] >= mags[k + 1]; };
+    if (lower >= 0 && lowerScore - bestScore > std::log (kOctaveRatio) && (isPeak (lower - 1) || isPeak (lower) || isPeak (lower + 1)))
+        best = lower;
+
+    // Refine from the partials: parabolic peaks on log magnitude (near exact for a Hann lobe)
+    const int radius = std::max (1, std::min (lobeBins / 2, best / 2 - 1));
+    const int reach = std::max (1, std::min (lobeBins, best / 2));
+    double weightedF0 = 0.0, weightSum = 0.0, partialEnergy = 0.0;
+    for (int h = 1; h <= kNumProducts; ++h)
+    {
+        const int lo = std::max (1, h * best - radius);
+        const int hi = std::min (numBins - 2, h * best + radius);
+
+        int loc = lo;
+        for (int k = lo + 1; k <= hi; ++k)
+            if (mags[k] > mags[loc])
+                loc = k;
+
+        double bin = loc;
+        const double a = logMag[loc - 1], b = logMag[loc], c = logMag[loc + 1];
+        const double denom = a - 2.0 * b + c;
+        if (loc > lo && loc < hi && std::abs (denom) > 1e-12)
+            bin += 0.5 * (a - c) / denom;
+
+        weightedF0 += mags[loc] * bin * binHz / h;
+        weightSum += mags[loc];
+
+        for (int k = std::max (0, loc - reach); k <= std::min (numBins - 1, loc + reach); ++k)
+            partialEnergy += (double) mags[k] * mags[k];
+    }
+
+    if (weightSum <= 0.0)
+        return 0.0f;
+
+    double bandEnergy = 0.0;
+    const int bandEnd = std::min (numBins - 1, (kNumProducts + 1) * best);
+    for (int k = 0; k <= bandEnd; ++k)
+        bandEnergy += (double) mags[k] * mags[k];
+
+    lastAperiodicity = (float) std::clamp (1.0 - partialEnergy / std::max (bandEnergy, 1e-18), 0.0, 1.0);
+    return (float) (weightedF0 / weightSum);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <vector>
+
+// How the f0 search covers the lag range
+enum class PitchSearch
+{
+    yin, // every lag, full rate
+    pyramid // coarse candidates, full rate only around them
+};
+
+// Which estimator picks the f0 of a plucked note
+enum class PitchBackend
+{
+    yin, // cumulative mean normalised difference (time domain)
+    mpm, // McLeod normalised square difference (time domain)
+    hps // harmonic product spectrum on the analysis FFT
+};
+
+// ================================================================
+// Scratch memory for the estimators below. An analyser only runs one
+// estimate at a time, so all of its estimators can point at one arena;
+// each prepare() grows it to what that estimator needs, it never shrinks.
+struct PitchScratch
+{
+    std::vector<float> frame;
+    std::vector<double> energy;
+    std::vector<double> lag; // difference / NSDF per lag, or HPS per bin
+    std::vector<double> normalised;
+
+    void reserve (int frameLength, int numLags);
+};
+
+// ================================================================
+// YIN-style f0 estimator (port of estimate_f0_yin from the notebook).
+// All scratch is sized in prepare(), so estimate() never allocates.
+class YinPitchDetector
+{
+public:
+    // sharedScratch, when given, must outlive the detector
+    void prepare (double sampleRate, int maxFrameLength, float fMin, float fMax, PitchScratch* sharedScratch = nullptr);
+
+    // Returns f0 in Hz, or 0 when the frame is too short / unvoiced
+    float estimate (const float* frame, int numSamples, float threshold = 0.1f);
+
+    // CMNDF value at the chosen period of the last estimate (lower = more periodic)
+    float getLastAperiodicity() const { return lastAperiodicity; }
+
+private:
+    double sampleRate { 44100.0 };
+    int minTau { 1 };
+    int maxTau { 1 };
+    int maxFrame { 0 };
+
+    PitchScratch& getScratch() { return sharedScratch != nullptr ? *sharedScratch : ownScratch; }
+
+    PitchScratch ownScratch;
+    PitchScratch* sharedScratch { nullptr };
+    float lastAperiodicity { 1.0f };
+};
+
+// ================================================================
+// Coarse-to-fine variant of the same search.
+// A YIN pass over a 4x decimated copy of the frame picks a few candidate
+// periods; the full-rate difference function is then only evaluated in a
+// narrow lag band around each one. Most of the lag range is skipped, and the
+// parabolic refinement at full rate keeps the sub-sample accuracy.
+// Aperiodicity here is the normalised difference d(tau) / (E0 + Etau) of
+// the overlapping part, 0 for a perfectly periodic frame.
+class PyramidPitchDetector
+{
+public:
+    void prepare (double sampleRate, int maxFrameLength, float fMin, float fMax);
+    float estimate (const float* frame, int numSamples, float threshold = 0.1f);
+    float getLastAperiodicity() const { return lastAperiodicity; }
+
+private:
+    static constexpr int kCoarseFactor = 4;
+    static constexpr int kFineRadius = kCoarseFactor + 1; // lags either side of a coarse candidate
+    static constexpr int kMaxCandidates = 4;
+    static constexpr double kCoarseThreshold = 0.6;
+
+    double sampleRate { 44100.0 };
+    int minTau { 1 }, maxTau { 1 };
+    int coarseMinTau { 1 }, coarseMaxTau { 1 };
+    int maxFrame { 0 };
+
+    std::vector<float> buffer; // windowed, for the coarse pass
+    std::vector<float> raw; // DC removed only, for the fine pass
+    std::vector<double> tailEnergy;
+    std::vector<float> coarse;
+    std::vector<double> coarseTailEnergy;
+    std::vector<double> coarseDiff;
+    std::vector<double> coarseCmndf;
+    float lastAperiodicity { 1.0f };
+};
+
+// ================================================================
+// McLeod pitch method: normalised square difference
+// n(tau) = 2 r(tau) / m(tau) on the DC-removed (unwindowed) frame. The
+// highest peak of each positive lobe is a key maximum, and the first one
+// within threshold of the tallest wins, which keeps it off the octave below.
+// Aperiodicity is 1 - n(tau) at the chosen period.
+class McLeodPitchDetector
+{
+public:
+    // sharedScratch, when given, must outlive the detector
+    void prepare (double sampleRate, int maxFrameLength, float fMin, float fMax, PitchScratch* sharedScratch = nullptr);
+
+    // Returns f0 in Hz, or 0 when the frame is too short / has no positive lobe
+    float estimate (const float* frame, int numSamples, float threshold = 0.1f);
+    float getLastAperiodicity() const { return lastAperiodicity; }
+
+private:
+    double sampleRate { 44100.0 };
+    int minTau { 1 };
+    int maxTau { 1 };
+    int maxFrame { 0 };
+
+    PitchScratch& getScratch() { return sharedScratch != nullptr ? *sharedScratch : ownScratch; }
+
+    PitchScratch ownScratch;
+    PitchScratch* sharedScratch { nullptr };
+    float lastAperiodicity { 1.0f };
+};
+
+// ================================================================
+// Harmonic product spectrum on a magnitude spectrum that's already been
+// computed for harmonic tracking, so there's no extra FFT or lag search.
+// Scores each fundamental bin by the log magnitudes of its first few
+// multiples, checks the octave below (a weak fundamental makes HPS jump
+// up an octave) and refines f0 from the parabolic peaks of the partials.
+// Meant for clean DI; it has no notion of the time-domain period.
+// Aperiodicity is the share of the band's energy outside the partials' main lobes.
+class HpsPitchDetector
+{
+public:
+    static constexpr int kNumProducts = 5;
+
+    // Geometry of the spectra estimate() will see: numBins of a real FFT of a
+    // Hann-windowed frameLength frame. sharedScratch must outlive the detector.
+    void prepare (double sampleRate, int numBins, int frameLength, float fMin, float fMax, PitchScratch* sharedScratch = nullptr);
+
+    // Returns f0 in Hz, or 0 when nothing stands out
+    float estimate (const float* magnitudes);
+    float getLastAperiodicity() const { return lastAperiodicity; }
+
+private:
+    double binHz { 1.0 };
+    int numBins { 0 };
+    int minBin { 1 }, maxBin { 1 };
+    int lobeBins { 1 };
+
+    PitchScratch& getScratch() { return sharedScratch != nullptr ? *sharedScratch : ownScratch; }
+
+    PitchScratch ownScratch;
+    PitchScratch* sharedScratch { nullptr };
+    float lastAperiodicity { 1.0f };
+};
@@ -0,0 +1,96 @@
+#include "PitchTracker.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Normalised difference (0 = perfectly periodic, 1 = uncorrelated) above which a hop is unvoiced
+    constexpr float kVoicedThreshold = 0.25f;
+} // namespace
+
+void PitchTracker::prepare (double newSampleRate, float newFMin, float newFMax)
+{
+    sampleRate = newSampleRate;
+    fMin = newFMin;
+    fMax = newFMax;
+
+    // A band around the lowest note reaches below fMin. Two of its longest
+    // periods is also enough for the full search, and keeps a band locked on
+    // a low B or E from running out of signal.
+    const int maxTau = (int) std::ceil (sampleRate / fMin * std::exp2 (kBandSemitones / 12.0)) + 2;
+    diff.assign ((size_t) maxTau + 1, 0.0f);
+
+    fullWindow = 2 * maxTau;
+    yin.prepare (sampleRate, fullWindow, fMin, fMax);
+    pyramid.prepare (sampleRate, fullWindow, fMin, fMax);
+    period = 0.0f;
+}
+
+int PitchTracker::getRequiredWindow() const
+{
+    if (period <= 0.0f)
+        return fullWindow;
+
+    const int hi = (int) std::ceil (period * std::exp2 (kBandSemitones / 12.0)) + 1;
+    return std::min (fullWindow, 2 * hi + 2);
+}
+
+float PitchTracker::process (const float* frame, int numSamples)
+{
+    if (period > 0.0f)
+    {
+        const int lo = std::max (2, (int) std::floor (period * std::exp2 (-kBandSemitones / 12.0)) - 1);
+        const int hi = std::min ((int) diff.size() - 2, (int) std::ceil (period * std::exp2 (kBandSemitones / 12.0)) + 1);
+        const float f0 = searchBand (frame, numSamples, lo, hi);
+        if (f0 > 0.0f)
+            return f0;
+
+        period = 0.0f; // lost it, search everything next time
+    }
+
+    const int n = std::min (numSamples, fullWindow);
+    const bool usePyramid = search == PitchSearch::pyramid;
+    const float f0 = usePyramid ? pyramid.estimate (frame + numSamples - n, n, 0.15f)
+                                : yin.estimate (frame + numSamples - n, n, 0.15f);
+    const float aperiodicity = usePyramid ? pyramid.getLastAperiodicity() : yin.getLastAperiodicity();
+    if (f0 < fMin || f0 > fMax || aperiodicity > kVoicedThreshold)
+        return 0.0f;
+
+    period = (float) (sampleRate / f0);
+    return f0;
+}
+
+float PitchTracker::searchBand (const float* frame, int numSamples, int lo, int hi)
+{
+    // Integrate over one max-lag worth of the newest samples
+    const int integration = hi + 1;
+    if (numSamples < integration + hi + 1)
+        return 0.0f;
+
+    const float* x = frame + numSamples - (integration + hi + 1);
+
+    int best = -1;
+    for (int tau = lo - 1; tau <= hi + 1; ++tau)
+    {
+        float d = 0.0f, energy = 0.0f;
+        for (int j = 0; j < integration; ++j)
+        {
+            const float delta = x[j] - x[j + tau];
+            d += delta * delta;
+            energy += x[j] * x[j] + x[j + tau] * x[j + tau];
+        }
+
+        diff[(size_t) tau] = energy > 1e-9f ? d / energy : 1.0f;
+        if (tau >= lo && tau <= hi && (best < 0 || diff[(size_t) tau] < diff[(size_t) best]))
+            best = tau;
+    }
+
+    // Minimum on the band edge means the note moved out of it
+    if (best <= lo || best >= hi || diff[(size_t) best] > kVoicedThreshold)
+        return 0.0f;
+
+    const float a = diff[(size_t) best - 1], b = diff[(size_t) best], c = diff[(size_t) best + 1];
+    const float denom = a - 2.0f * b + c;
+    period = (float) best + (std::abs (denom) > 1e-12f ? 0.5f * (a - c) / denom : 0.0f);
+    return (float) (sampleRate / period);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "PitchDetection.h"
+#include <vector>
+
+// ================================================================
+// Incremental hop-rate pitch tracker for legato playing.
+// Once locked, each hop only evaluates the difference function in a
+// narrow lag band around the previous period (±kBandSemitones) over about
+// two periods of signal, instead of a full YIN over every lag. It falls
+// back to a full search when it loses the note.
+class PitchTracker
+{
+public:
+    static constexpr float kBandSemitones = 3.0f;
+
+    void prepare (double sampleRate, float fMin, float fMax);
+
+    // How the tracker searches when it isn't locked
+    void setSearch (PitchSearch newSearch) { search = newSearch; }
+
+    void reset() { period = 0.0f; }
+
+    // Start from a known pitch, e.g. the f0 of a freshly plucked note
+    void prime (float f0) { period = f0 > 0.0f ? (float) (sampleRate / f0) : 0.0f; }
+
+    // Samples the next process() call wants (the tail of the signal)
+    int getRequiredWindow() const;
+
+    // frame holds the most recent samples, newest last. Returns f0 or 0 when unvoiced.
+    float process (const float* frame, int numSamples);
+
+private:
+    float searchBand (const float* x, int numSamples, int lo, int hi);
+
+    double sampleRate { 44100.0 };
+    float fMin { 28.0f }, fMax { 400.0f };
+    int fullWindow { 0 };
+    float period { 0.0f }; // 0 = not locked
+
+    PitchSearch search { PitchSearch::yin };
+    YinPitchDetector yin;
+    PyramidPitchDetector pyramid;
+    std::vector<float> diff;
+};
@@ -1,4 +1,5 @@
 #include "PluginEditor.h"
+#include <algorithm>
 #include <cmath>
 
 // ================================================================
@@ -28,7 +29,7 @@ namespace
     constexpr auto kHighlightBB = 0xff67b8ff;
 
     // Geometry
-    constexpr int kNumStrings = 4;
+    constexpr int kMaxStrings = kMaxBassStrings; // rows follow the current tuning
     constexpr int kNumFrets = 12; // 1..12 on board (0 = open)
 
     // Note names
@@ -42,22 +43,11 @@ namespace
         return juce::String (kNoteNames[idx]) + juce::String (oct);
     }
 
-    // Map GUI rows to bass strings, bottom->top should be E A D G.
-    // Our rows are indexed top=0 ... bottom=3, so:
-    //   row 0 (top) -> G2, row 1 -> D2, row 2 -> A1, row 3 (bottom) -> E1
-    inline int baseMidiForString (int stringIdx)
+    // Map GUI rows to bass strings: rows are indexed top=0 ... bottom,
+    // tunings list strings lowest first, so the lowest string is the bottom row.
+    inline int baseMidiForRow (const BassTuning& tuning, int row)
     {
-        switch (stringIdx)
-        {
-            case 0:
-                return 43; // G2 (top row)
-            case 1:
-                return 38; // D2
-            case 2:
-                return 33; // A1
-            default:
-                return 28; // E1 (bottom row)
-        }
+        return tuning.getOpenMidi (tuning.getNumStrings() - 1 - row);
     }
 
     // Cubic ease-out 0..1
@@ -83,10 +73,25 @@ public:
 
     std::function<void (const juce::String&)> onNotePlayed;
 
+    int getNumStrings() const { return numStrings; }
+    int getTuningIndex() const { return tuningIndex; }
+
+    void setTuning (int newTuningIndex)
+    {
+        if (newTuningIndex == tuningIndex)
+            return;
+
+        tuningIndex = newTuningIndex;
+        numStrings = getTuning (tuningIndex).getNumStrings();
+        active.clear();
+        rebuildStatic();
+        repaint();
+    }
+
     // External trigger (e.g., from ML/UI)
     void triggerNote (int stringIdx, int fretIdx)
     {
-        if (stringIdx < 0 || stringIdx >= kNumStrings)
+        if (stringIdx < 0 || stringIdx >= numStrings)
             return;
         if (fretIdx < 0 || fretIdx > kNumFrets)
             return;
@@ -100,7 +105,7 @@ public:
         a.stringIdx = stringIdx;
         a.fretIdx = fretIdx;
         a.isOpen = (fretIdx == 0);
-        a.noteName = midiToNote (baseMidiForString (stringIdx) + fretIdx);
+        a.noteName = midiToNote (baseMidiForRow (getTuning (tuningIndex), stringIdx) + fretIdx);
 
         // center for circular highlight (same size as open-string circles)
         if (a.isOpen)
@@ -126,6 +131,23 @@ public:
         repaint (a.bounds.toNearestInt()); // tight repaint
     }
 
+    // A corrected note: the latest highlight at the old position goes, the new one starts
+    void moveNote (int fromString, int fromFret, int toString, int toFret)
+    {
+        for (int i = active.size(); --i >= 0;)
+        {
+            const auto& a = active.getReference (i);
+            if (a.stringIdx == fromString && a.fretIdx == fromFret)
+            {
+                repaint (a.bounds.toNearestInt());
+                active.remove (i);
+                break;
+            }
+        }
+
+        triggerNote (toString, toFret);
+    }
+
     void paint (juce::Graphics& g) override
     {
         g.fillAll (juce::Colour (kPluginBg));
@@ -171,7 +193,7 @@ public:
         const auto p = e.position;
 
         // Open strings first
-        for (int s = 0; s < kNumStrings; ++s)
+        for (int s = 0; s < numStrings; ++s)
         {
             if (openCircles[s].contains (p))
             {
@@ -185,7 +207,7 @@ public:
 
         // Which string
         int stringIdx = -1;
-        for (int s = 0; s < kNumStrings; ++s)
+        for (int s = 0; s < numStrings; ++s)
             if (rowRects[s].contains (p))
             {
                 stringIdx = s;
@@ -223,8 +245,10 @@ private:
 
     // Geometry
     juce::Rectangle<float> boardBounds; // frets 1..12
-    juce::Rectangle<float> rowRects[kNumStrings]; // per-string rows
-    juce::Rectangle<float> openCircles[kNumStrings]; // open-string ellipses
+    juce::Rectangle<float> rowRects[kMaxStrings]; // per-string rows
+    juce::Rectangle<float> openCircles[kMaxStrings]; // open-string ellipses
+    int tuningIndex { tuningStandard4 };
+    int numStrings { 4 };
     float openRadius { 0.0f }; // shared with highlight circles
 
     // Reusable paths
@@ -273,8 +297,8 @@ private:
         g.fillRoundedRectangle (boardBounds, 6.0f);
 
         // Rows
-        const float rowH = boardBounds.getHeight() / (float) kNumStrings;
-        for (int s = 0; s < kNumStrings; ++s)
+        const float rowH = boardBounds.getHeight() / (float) numStrings;
+        for (int s = 0; s < numStrings; ++s)
         {
             auto r = boardBounds.withY (boardBounds.getY() + s * rowH)
                          .withHeight (rowH);
@@ -283,7 +307,7 @@ private:
 
         // Strings: a tad thicker (1.5 px), from nut to board end
         stringLines.clear();
-        for (int s = 0; s < kNumStrings; ++s)
+        for (int s = 0; s < numStrings; ++s)
         {
             const float y = rowRects[s].getCentreY() + 0.5f;
             stringLines.startNewSubPath (std::round (boardBounds.getX()) + 0.5f, y);
@@ -345,7 +369,7 @@ private:
         // Slightly bigger gap than before to avoid any nut overlap
         const float openGap = 12.0f; // px
 
-        for (int s = 0; s < kNumStrings; ++s)
+        for (int s = 0; s < numStrings; ++s)
         {
             const float cy = rowRects[s].getCentreY();
             const float nutX = std::round (boardBounds.getX()) + 0.5f;
@@ -380,6 +404,7 @@ PluginEditor::PluginEditor (PluginProcessor& p)
     : AudioProcessorEditor (&p), processorRef (p)
 {
     fretboard = std::make_unique<FretboardComponent>();
+    fretboard->setTuning (processorRef.getTuningIndex());
     addAndMakeVisible (*fretboard);
 
     lastNoteLabel.setText ("Click a fret or an open circle", juce::dontSendNotification);
@@ -406,6 +431,9 @@ PluginEditor::PluginEditor (PluginProcessor& p)
 
     setResizable (true, true);
     setSize (980, 340);
+
+    // Poll the analyser for detected notes
+    startTimerHz (30);
 }
 
 PluginEditor::~PluginEditor() = default;
@@ -428,3 +456,47 @@ void PluginEditor::resized()
 
     fretboard->setBounds (area);
 }
+
+void PluginEditor::timerCallback()
+{
+    fretboard->setTuning (processorRef.getTuningIndex());
+
+    NoteEvent events[16];
+    const int numEvents = processorRef.popNoteEvents (events, (int) std::size (events));
+
+    for (int i = 0; i < numEvents; ++i)
+    {
+        const auto& e = events[i];
+        if (! e.isValid() || e.tuning != fretboard->getTuningIndex())
+            continue;
+
+        // Analysis counts strings from the lowest, rows count from the top
+        const int row = fretboard->getNumStrings() - 1 - e.stringIdx;
+
+        if (e.provisional)
+        {
+            provisionalNotes.push_back (e);
+            if (provisionalNotes.size() > 16)
+                provisionalNotes.erase (provisionalNotes.begin());
+
+            fretboard->triggerNote (row, e.fret);
+            continue;
+        }
+
+        // The final event for a note already shown as a guess only moves it if the guess was wrong
+        const auto guess = std::find_if (provisionalNotes.begin(), provisionalNotes.end(), [&] (const NoteEvent& p) {
+            return p.input == e.input && p.onsetSample == e.onsetSample;
+        });
+
+        if (guess == provisionalNotes.end())
+        {
+            fretboard->triggerNote (row, e.fret);
+            continue;
+        }
+
+        if (guess->stringIdx != e.stringIdx || guess->fret != e.fret)
+            fretboard->moveNote (fretboard->getNumStrings() - 1 - guess->stringIdx, guess->fret, row, e.fret);
+
+        provisionalNotes.erase (guess);
+    }
+}
@@ -8,10 +8,12 @@
 #endif
 
 #include <memory>
+#include <vector>
 
 class FretboardComponent;
 
-class PluginEditor : public juce::AudioProcessorEditor
+class PluginEditor : public juce::AudioProcessorEditor,
+                     private juce::Timer
 {
 public:
     explicit PluginEditor (PluginProcessor&);
@@ -21,10 +23,13 @@ public:
     void resized() override;
 
 private:
+    void timerCallback() override;
+
     PluginProcessor& processorRef;
 
     std::unique_ptr<FretboardComponent> fretboard;
     juce::Label lastNoteLabel;
+    std::vector<NoteEvent> provisionalNotes; // shown, waiting for their final events
 
 #if JUCE_MODULE_AVAILABLE_melatonin_inspector
     std::unique_ptr<melatonin::Inspector> inspector;
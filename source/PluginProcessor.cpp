@@ -1,5 +1,24 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "PluginState.h"
+#include <cstring>
+
+namespace
+{
+    // True when the stream holds leadingBytes, a null-terminated string and then
+    // trailingBytes more, so a record can be read without running off the end
+    bool hasRecord (const juce::MemoryInputStream& stream, size_t leadingBytes, size_t trailingBytes)
+    {
+        const auto size = stream.getDataSize();
+        const auto start = (size_t) stream.getPosition() + leadingBytes;
+        if (start >= size)
+            return false;
+
+        const auto* data = static_cast<const char*> (stream.getData());
+        const auto* terminator = static_cast<const char*> (std::memchr (data + start, 0, size - start));
+        return terminator != nullptr && size - (size_t) (terminator + 1 - data) >= trailingBytes;
+    }
+} // namespace
 
 //==============================================================================
 PluginProcessor::PluginProcessor()
@@ -7,15 +26,57 @@ PluginProcessor::PluginProcessor()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
+                       .withInput  ("Sidechain", juce::AudioChannelSet::mono(), false)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
                        )
 {
+    doubleStops = parameters.getRawParameterValue ("doubleStops");
+    legatoTracking = parameters.getRawParameterValue ("legatoTracking");
+    positionDecoding = parameters.getRawParameterValue ("positionDecoding");
+    tuning = parameters.getRawParameterValue ("tuning");
+    maxFret = parameters.getRawParameterValue ("maxFret");
+    onsetThreshold = parameters.getRawParameterValue ("onsetThreshold");
+    latencyMode = parameters.getRawParameterValue ("latencyMode");
+    midiOutput = parameters.getRawParameterValue ("midiOutput");
+    separateInputs = parameters.getRawParameterValue ("separateInputs");
+    parameters.addParameterListener ("separateInputs", this);
+
+    for (auto& notes : soundingNotes)
+        notes.fill (-1);
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout PluginProcessor::createParameterLayout()
+{
+    juce::StringArray tuningNames;
+    for (const auto& t : kTuningDescriptors)
+        tuningNames.add (t.name);
+
+    // Stored as linear gain so the audio thread uses it as is, shown in dB
+    const auto toDb = [] (float gain, int) { return juce::String (juce::Decibels::gainToDecibels (gain), 1) + " dB"; };
+    const auto fromDb = [] (const juce::String& text) { return juce::Decibels::decibelsToGain (text.getFloatValue()); };
+    juce::NormalisableRange<float> thresholdRange (0.001f, 0.3f);
+    thresholdRange.setSkewForCentre (0.02f);
+
+    return {
+        std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "doubleStops", 1 }, "Double stops", false),
+        std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "legatoTracking", 1 }, "Legato tracking", false),
+        std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "positionDecoding", 1 }, "Position decoding", false),
+        std::make_unique<juce::AudioParameterChoice> (juce::ParameterID { "tuning", 1 }, "Tuning", tuningNames, tuningStandard4),
+        std::make_unique<juce::AudioParameterInt> (juce::ParameterID { "maxFret", 1 }, "Max fret", 12, kMaxFretLimit, kDefaultMaxFret),
+        std::make_unique<juce::AudioParameterFloat> (juce::ParameterID { "onsetThreshold", 1 }, "Onset threshold", thresholdRange,
+            AnalysisConfig().onsetThreshold, juce::AudioParameterFloatAttributes().withStringFromValueFunction (toDb).withValueFromStringFunction (fromDb)),
+        std::make_unique<juce::AudioParameterChoice> (juce::ParameterID { "latencyMode", 1 }, "Latency", juce::StringArray { "Standard", "Low" }, 0),
+        std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "midiOutput", 1 }, "MIDI output", false),
+        std::make_unique<juce::AudioParameterBool> (juce::ParameterID { "separateInputs", 1 }, "Separate inputs", false),
+    };
 }
 
 PluginProcessor::~PluginProcessor()
 {
+    parameters.removeParameterListener ("separateInputs", this);
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -86,15 +147,83 @@ void PluginProcessor::changeProgramName (int index, const juce::String& newName)
 //==============================================================================
 void PluginProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    // Use this method as the place to do any pre-playback
-    // initialisation that you need..
-    juce::ignoreUnused (sampleRate, samplesPerBlock);
+    monoBuffer.assign ((size_t) samplesPerBlock, 0.0f);
+
+    // Hosts announce offline bounces before preparing; those get the slow, accurate path
+    for (auto& engine : analysisEngines)
+        engine.setOffline (isNonRealtime());
+
+    analysisEngines[0].prepare (sampleRate, samplesPerBlock);
+    preparedSampleRate = sampleRate;
+    preparedBlockSize = samplesPerBlock;
+
+    // A new layout or rate, the other inputs are set up again if they're still wanted
+    extraInputsReady.store (false);
+    for (size_t i = 1; i < analysisEngines.size(); ++i)
+        analysisEngines[i].release();
+    extraInputsPrepared = false;
+    updateExtraInputs();
 }
 
 void PluginProcessor::releaseResources()
 {
-    // When playback stops, you can use this as an opportunity to free up any
-    // spare memory, etc.
+    cancelPendingUpdate();
+    extraInputsReady.store (false);
+    extraInputsPrepared = false;
+    preparedSampleRate = 0.0;
+
+    for (auto& engine : analysisEngines)
+        engine.release();
+}
+
+int PluginProcessor::getNumAnalysisChannels() const
+{
+    // Same choice of bus as getAnalysisInput()
+    if (getBusCount (true) > 1)
+        if (const auto* sidechain = getBus (true, 1); sidechain != nullptr && sidechain->isEnabled()
+                                                      && sidechain->getNumberOfChannels() > 0)
+            return sidechain->getNumberOfChannels();
+
+    return getBusCount (true) > 0 ? getChannelCountOfBus (true, 0) : 0;
+}
+
+void PluginProcessor::updateExtraInputs()
+{
+    const bool wanted = preparedSampleRate > 0.0 && separateInputs->load() >= 0.5f && getNumAnalysisChannels() > 1;
+    if (wanted == extraInputsPrepared)
+        return;
+
+    if (wanted)
+    {
+        // The audio thread leaves these engines alone until the flag is set
+        for (size_t i = 1; i < analysisEngines.size(); ++i)
+            analysisEngines[i].prepare (preparedSampleRate, preparedBlockSize);
+        extraInputsReady.store (true);
+    }
+    else
+    {
+        // Once the lock is released no block is still using them
+        {
+            const juce::ScopedLock lock (getCallbackLock());
+            extraInputsReady.store (false);
+        }
+
+        for (size_t i = 1; i < analysisEngines.size(); ++i)
+            analysisEngines[i].release();
+    }
+
+    extraInputsPrepared = wanted;
+}
+
+void PluginProcessor::parameterChanged (const juce::String&, float)
+{
+    // Can come from the audio thread when the host automates it
+    triggerAsyncUpdate();
+}
+
+void PluginProcessor::handleAsyncUpdate()
+{
+    updateExtraInputs();
 }
 
 bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -113,6 +242,16 @@ bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
    #if ! JucePlugin_IsSynth
     if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
         return false;
+
+    // The DI sidechain only feeds the analyser, so it can be off, mono or stereo
+    if (layouts.inputBuses.size() > 1)
+    {
+        const auto sidechain = layouts.getChannelSet (true, 1);
+        if (! sidechain.isDisabled()
+         && sidechain != juce::AudioChannelSet::mono()
+         && sidechain != juce::AudioChannelSet::stereo())
+            return false;
+    }
    #endif
 
     return true;
@@ -122,8 +261,6 @@ bool PluginProcessor::isBusesLayoutSupported (const BusesLayout& layouts) const
 void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer,
                                               juce::MidiBuffer& midiMessages)
 {
-    juce::ignoreUnused (midiMessages);
-
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
@@ -137,17 +274,126 @@ void PluginProcessor::processBlock (juce::AudioBuffer<float>& buffer,
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    // This is the place where you'd normally do the guts of your plugin's
-    // audio processing...
-    // Make sure to reset the state if your inner loop is processing
-    // the samples and the outer loop is handling the channels.
-    // Alternatively, you can process the samples with the channels
-    // interleaved by keeping the same state.
-    for (int channel = 0; channel < totalNumInputChannels; ++channel)
+    // Audio passes through untouched, the analyser only listens to a mono downmix
+    // of the DI sidechain when one is connected, of the main input otherwise
+    const auto source = getAnalysisInput (buffer);
+    const auto numSourceChannels = source.getNumChannels();
+    if (numSourceChannels == 0 || monoBuffer.empty())
+        return;
+
+    // Plain atomic loads; everything derived from them was built ahead of time
+    AnalysisSettings settings;
+    settings.maxVoices = doubleStops->load() >= 0.5f ? kMaxVoices : 1;
+    settings.tuning = (int) tuning->load();
+    settings.maxFret = (int) maxFret->load();
+    settings.tracking = legatoTracking->load() >= 0.5f;
+    settings.positionDecoding = positionDecoding->load() >= 0.5f;
+    settings.onsetThreshold = onsetThreshold->load();
+    settings.lowLatency = latencyMode->load() >= 0.5f;
+    settings.midiOutput = midiOutput->load() >= 0.5f;
+
+    // Separate inputs: every channel is its own instrument with its own engine,
+    // read straight from the host's buffer, once those engines have been prepared.
+    // Mono sources don't need a downmix either.
+    const bool separate = separateInputs->load() >= 0.5f && extraInputsReady.load();
+    const int numInputs = separate ? juce::jmin (numSourceChannels, kMaxInputs) : 1;
+    if (separate || numSourceChannels == 1)
     {
-        auto* channelData = buffer.getWritePointer (channel);
-        juce::ignoreUnused (channelData);
-        // ..do something to the data...
+        for (int i = 0; i < numInputs; ++i)
+            analysisEngines[(size_t) i].process (source.getReadPointer (i), source.getNumSamples(), settings);
+    }
+    else
+    {
+        const auto gain = 1.0f / (float) numSourceChannels;
+        const auto maxChunk = (int) monoBuffer.size();
+
+        // Some hosts send blocks bigger than announced, so go in chunks
+        for (int pos = 0; pos < source.getNumSamples(); pos += maxChunk)
+        {
+            const auto n = juce::jmin (maxChunk, source.getNumSamples() - pos);
+            juce::FloatVectorOperations::copyWithMultiply (monoBuffer.data(), source.getReadPointer (0, pos), gain, n);
+            for (int channel = 1; channel < numSourceChannels; ++channel)
+                juce::FloatVectorOperations::addWithMultiply (monoBuffer.data(), source.getReadPointer (channel, pos), gain, n);
+
+            analysisEngines[0].process (monoBuffer.data(), n, settings);
+        }
+    }
+
+    writeMidi (midiMessages, settings.midiOutput, numInputs);
+}
+
+int PluginProcessor::popNoteEvents (NoteEvent* dest, int maxEvents)
+{
+    int numRead = 0;
+    for (int i = 0; i < kMaxInputs; ++i)
+    {
+        const int n = analysisEngines[(size_t) i].popNoteEvents (dest + numRead, maxEvents - numRead);
+        for (int j = numRead; j < numRead + n; ++j)
+            dest[j].input = i;
+        numRead += n;
+    }
+    return numRead;
+}
+
+juce::AudioBuffer<float> PluginProcessor::getAnalysisInput (juce::AudioBuffer<float>& buffer)
+{
+    // Bus buffers alias the host's channels, nothing is copied and the main bus is only read
+    if (getBusCount (true) > 1)
+        if (auto* sidechain = getBus (true, 1); sidechain != nullptr && sidechain->isEnabled()
+                                                && sidechain->getNumberOfChannels() > 0)
+            return getBusBuffer (buffer, true, 1);
+
+    if (getBusCount (true) == 0)
+        return {};
+
+    return getBusBuffer (buffer, true, 0);
+}
+
+void PluginProcessor::loadModel (int tuningIndex, const juce::File& file, std::function<void (const juce::String&)> onLoaded)
+{
+    modelStore->loadAsync (tuningIndex, file, std::move (onLoaded));
+}
+
+void PluginProcessor::writeMidi (juce::MidiBuffer& midi, bool enabled, int numInputs)
+{
+    // One channel per string, like a MIDI bass pickup; a new note on a string ends the one before,
+    // and every note ends once the input has died down to the noise floor.
+    // Each input gets its own block of channels.
+    static_assert (kMaxInputs * kMaxBassStrings <= 16);
+    for (int input = 0; input < kMaxInputs; ++input)
+    {
+        auto& sounding = soundingNotes[(size_t) input];
+        const int firstChannel = input * kMaxBassStrings + 1;
+        const bool active = enabled && input < numInputs;
+
+        NoteEvent notes[16];
+        auto& engine = analysisEngines[(size_t) input];
+        const int numNotes = engine.popMidiEvents (notes, (int) std::size (notes));
+        for (int i = 0; i < numNotes && active; ++i)
+        {
+            const auto& e = notes[i];
+            if (! e.isValid())
+                continue;
+
+            const int channel = firstChannel + e.stringIdx;
+            const int note = getTuning (e.tuning).getOpenMidi (e.stringIdx) + e.fret;
+            auto& stringNote = sounding[(size_t) e.stringIdx];
+            if (stringNote >= 0)
+                midi.addEvent (juce::MidiMessage::noteOff (channel, stringNote), 0);
+
+            midi.addEvent (juce::MidiMessage::noteOn (channel, note, (juce::uint8) 100), 0);
+            stringNote = note;
+        }
+
+        if (active && ! engine.isQuiet())
+            continue;
+
+        for (size_t s = 0; s < sounding.size(); ++s)
+        {
+            if (sounding[s] >= 0)
+                midi.addEvent (juce::MidiMessage::noteOff (firstChannel + (int) s, sounding[s]), 0);
+            sounding[s] = -1;
+        }
     }
 }
 
@@ -165,17 +411,63 @@ juce::AudioProcessorEditor* PluginProcessor::createEditor()
 //==============================================================================
 void PluginProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-    juce::ignoreUnused (destData);
+    // Parameters by ID, so added or removed ones don't shift the rest
+    juce::MemoryOutputStream params;
+    const auto& all = getParameters();
+    params.writeShort ((short) all.size());
+    for (auto* p : all)
+    {
+        const auto* ranged = dynamic_cast<const juce::RangedAudioParameter*> (p);
+        params.writeString (ranged != nullptr ? ranged->getParameterID() : juce::String());
+        params.writeFloat (ranged != nullptr ? ranged->convertFrom0to1 (ranged->getValue()) : 0.0f);
+    }
+
+    // Model overrides are shared by every instance, so each one saves all of them
+    juce::MemoryOutputStream models;
+    for (int t = 0; t < kNumTunings; ++t)
+    {
+        const auto file = modelStore->getOverride (t);
+        if (file == juce::File())
+            continue;
+
+        models.writeByte ((char) t);
+        models.writeString (file.getFullPathName());
+    }
+
+    PluginState::Writer writer;
+    writer.addSection (PluginState::parameters, params.getMemoryBlock());
+    writer.addSection (PluginState::modelFiles, models.getMemoryBlock());
+    writer.writeTo (destData);
 }
 
 void PluginProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory block,
-    // whose contents will have been created by the getStateInformation() call.
-    juce::ignoreUnused (data, sizeInBytes);
+    PluginState::Reader reader;
+    if (! reader.parse (data, sizeInBytes))
+        return;
+
+    const auto params = reader.getSection (PluginState::parameters);
+    juce::MemoryInputStream paramStream (params, false);
+    const int numParams = paramStream.getTotalLength() >= 2 ? (juce::uint16) paramStream.readShort() : 0;
+    for (int i = 0; i < numParams && hasRecord (paramStream, 0, sizeof (float)); ++i)
+    {
+        const auto id = paramStream.readString();
+        const auto value = paramStream.readFloat();
+        if (auto* p = parameters.getParameter (id))
+            p->setValueNotifyingHost (p->convertTo0to1 (value));
+    }
+
+    // Models load in the background, and files the shared store already has are skipped.
+    // A truncated record at the end is dropped rather than read as a bogus path.
+    const auto models = reader.getSection (PluginState::modelFiles);
+    juce::MemoryInputStream modelStream (models, false);
+    while (hasRecord (modelStream, 1, 0))
+    {
+        const int t = modelStream.readByte();
+        const auto path = modelStream.readString();
+        if (t >= 0 && t < kNumTunings && juce::File::isAbsolutePath (path) && juce::File (path).existsAsFile())
+            loadModel (t, juce::File (path), nullptr);
+    }
 }
 
 //==============================================================================
@@ -1,12 +1,15 @@
 #pragma once
 
+#include "AnalysisEngine.h"
 #include <juce_audio_processors/juce_audio_processors.h>
 
 #if (MSVC)
 #include "ipps.h"
 #endif
 
-class PluginProcessor : public juce::AudioProcessor
+class PluginProcessor : public juce::AudioProcessor,
+                        private juce::AudioProcessorValueTreeState::Listener,
+                        private juce::AsyncUpdater
 {
 public:
     PluginProcessor();
@@ -38,6 +41,58 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    // With separate inputs on, each channel of the analysed bus is its own instrument
+    static constexpr int kMaxInputs = 2;
+
+    // Detected notes for the UI, call from a single (message) thread. NoteEvent::input tells the inputs apart.
+    int popNoteEvents (NoteEvent* dest, int maxEvents);
+
+    int getTuningIndex() const { return (int) tuning->load(); }
+    juce::AudioProcessorValueTreeState& getValueTreeState() { return parameters; }
+
+    // Replaces a tuning's model for every instance without interrupting playback.
+    // The override is process-wide, so every instance saves the file in its state.
+    // Loading happens in the background, onLoaded gets the error (empty on success).
+    void loadModel (int tuningIndex, const juce::File& file, std::function<void (const juce::String&)> onLoaded);
+
 private:
+    // Every tuning's model is loaded up front by the first instance and shared by the rest;
+    // tunings without one fall back to low positions
+    juce::SharedResourcePointer<StringModelStore> modelStore;
+    std::array<AnalysisEngine, kMaxInputs> analysisEngines; // one per input, all on the shared pool and models
+    std::vector<float> monoBuffer;
+
+    static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    juce::AudioBuffer<float> getAnalysisInput (juce::AudioBuffer<float>& buffer); // sidechain if connected, else main in
+    void writeMidi (juce::MidiBuffer& midi, bool enabled, int numInputs);
+
+    // The inputs past the first only get an engine (and a pool slot) while separate
+    // inputs are on and the analysed bus has the channels for them. Switching while
+    // playing is picked up on the message thread.
+    int getNumAnalysisChannels() const;
+    void updateExtraInputs();
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;
+
+    juce::AudioProcessorValueTreeState parameters { *this, nullptr, "Parameters", createParameterLayout() };
+
+    // Raw parameter values, read lock-free on the audio thread
+    std::atomic<float>* doubleStops = nullptr;
+    std::atomic<float>* legatoTracking = nullptr;
+    std::atomic<float>* positionDecoding = nullptr;
+    std::atomic<float>* tuning = nullptr;
+    std::atomic<float>* maxFret = nullptr;
+    std::atomic<float>* onsetThreshold = nullptr;
+    std::atomic<float>* latencyMode = nullptr;
+    std::atomic<float>* midiOutput = nullptr;
+    std::atomic<float>* separateInputs = nullptr;
+
+    double preparedSampleRate { 0.0 }; // 0 while released (message thread)
+    int preparedBlockSize { 0 };
+    bool extraInputsPrepared { false }; // message thread
+    std::atomic<bool> extraInputsReady { false }; // read by the audio thread
+
+    std::array<std::array<int, kMaxBassStrings>, kMaxInputs> soundingNotes {}; // MIDI note per input and string, -1 when silent (audio thread)
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (PluginProcessor)
 };
@@ -0,0 +1,125 @@
+#include "PluginState.h"
+
+namespace
+{
+    constexpr uint32_t kMagic = 0x54534142; // "BAST"
+    constexpr size_t kHeaderBytes = 8; // magic, version, section count
+    constexpr size_t kEntryBytes = 13; // id, flags, stored size, raw size
+
+    // Deflate can't expand data by more than about 1032:1, and no section we
+    // write comes anywhere near 16 MB, so a larger raw size means a bad blob
+    constexpr uint64_t kMaxInflateRatio = 1032;
+    constexpr uint32_t kMaxRawBytes = 16 * 1024 * 1024;
+} // namespace
+
+namespace PluginState
+{
+    void Writer::addSection (SectionId id, const juce::MemoryBlock& payload, size_t compressAbove)
+    {
+        Section section { id, false, (uint32_t) payload.getSize(), payload };
+
+        if (payload.getSize() >= compressAbove)
+        {
+            juce::MemoryOutputStream deflated;
+            {
+                juce::GZIPCompressorOutputStream zip (deflated, 6, juce::GZIPCompressorOutputStream::windowBitsRaw);
+                zip.write (payload.getData(), payload.getSize());
+            }
+
+            if (deflated.getDataSize() < payload.getSize())
+            {
+                section.compressed = true;
+                section.data = deflated.getMemoryBlock();
+            }
+        }
+
+        sections.push_back (std::move (section));
+    }
+
+    void Writer::writeTo (juce::MemoryBlock& dest) const
+    {
+        juce::MemoryOutputStream out (dest, false);
+        out.writeInt ((int) kMagic);
+        out.writeShort ((short) kVersion);
+        out.writeShort ((short) sections.size());
+
+        for (const auto& s : sections)
+        {
+            out.writeInt ((int) s.id);
+            out.writeByte (s.compressed ? 1 : 0);
+            out.writeInt ((int) s.data.getSize());
+            out.writeInt ((int) s.rawSize);
+        }
+
+        for (const auto& s : sections)
+            out.write (s.data.getData(), s.data.getSize());
+    }
+
+    //==============================================================================
+    bool Reader::parse (const void* data, int sizeInBytes)
+    {
+        base = static_cast<const uint8_t*> (data);
+        entries.clear();
+
+        if (data == nullptr || (size_t) sizeInBytes < kHeaderBytes)
+            return false;
+
+        juce::MemoryInputStream in (data, (size_t) sizeInBytes, false);
+        if ((uint32_t) in.readInt() != kMagic)
+            return false;
+
+        version = (uint16_t) in.readShort();
+        const int numSections = (uint16_t) in.readShort();
+
+        auto offset = kHeaderBytes + (size_t) numSections * kEntryBytes;
+        if (offset > (size_t) sizeInBytes)
+            return false;
+
+        for (int i = 0; i < numSections; ++i)
+        {
+            Entry e;
+            e.id = (uint32_t) in.readInt();
+            e.compressed = (in.readByte() & 1) != 0;
+            e.storedSize = (uint32_t) in.readInt();
+            e.rawSize = (uint32_t) in.readInt();
+            e.offset = offset;
+            offset += e.storedSize;
+
+            const auto rawLimit = e.compressed ? (uint64_t) e.storedSize * kMaxInflateRatio : (uint64_t) e.storedSize;
+            if (e.rawSize > kMaxRawBytes || (uint64_t) e.rawSize > rawLimit || (! e.compressed && e.rawSize != e.storedSize))
+                return false;
+
+            entries.push_back (e);
+        }
+
+        return offset <= (size_t) sizeInBytes;
+    }
+
+    const Reader::Entry* Reader::find (SectionId id) const
+    {
+        for (const auto& e : entries)
+            if (e.id == (uint32_t) id)
+                return &e;
+        return nullptr;
+    }
+
+    juce::MemoryBlock Reader::getSection (SectionId id) const
+    {
+        const auto* e = find (id);
+        if (e == nullptr)
+            return {};
+
+        if (! e->compressed)
+            return { base + e->offset, e->storedSize };
+
+        juce::MemoryInputStream stored (base + e->offset, e->storedSize, false);
+        juce::GZIPDecompressorInputStream zip (&stored, false, juce::GZIPDecompressorInputStream::deflateFormat);
+
+        juce::MemoryBlock raw;
+        raw.setSize (e->rawSize);
+        if (zip.read (raw.getData(), (int) e->rawSize) != (int) e->rawSize)
+            return {};
+
+        return raw;
+    }
+} // namespace PluginState
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#include <cstdint>
+#include <vector>
+
+// ================================================================
+// Versioned binary plugin state: a fixed header and a section table up
+// front, then the section payloads back to back. Restoring only parses the
+// table; a section is copied (and inflated, when it was stored compressed)
+// when it's asked for, so big payloads cost nothing until they're needed
+// and unknown sections from newer versions are simply skipped.
+namespace PluginState
+{
+    constexpr int kVersion = 1;
+
+    enum SectionId : uint32_t
+    {
+        parameters = 0x4d524150, // "PARM"
+        modelFiles = 0x4c444f4d, // "MODL", the process-wide model override per tuning
+    };
+
+    class Writer
+    {
+    public:
+        // Payloads at least compressAbove bytes long are stored deflated (when that's smaller)
+        void addSection (SectionId id, const juce::MemoryBlock& payload, size_t compressAbove = 512);
+        void writeTo (juce::MemoryBlock& dest) const;
+
+    private:
+        struct Section
+        {
+            SectionId id;
+            bool compressed;
+            uint32_t rawSize;
+            juce::MemoryBlock data;
+        };
+
+        std::vector<Section> sections;
+    };
+
+    class Reader
+    {
+    public:
+        // Header and section table only, the data has to outlive the reader.
+        // False when it isn't our format, is truncated, or a section claims a
+        // raw size its stored bytes couldn't inflate to.
+        bool parse (const void* data, int sizeInBytes);
+
+        int getVersion() const { return version; }
+        bool hasSection (SectionId id) const { return find (id) != nullptr; }
+
+        // Empty when there's no such section or it doesn't inflate to its recorded size
+        juce::MemoryBlock getSection (SectionId id) const;
+
+    private:
+        struct Entry
+        {
+            uint32_t id;
+            bool compressed;
+            uint32_t storedSize;
+            uint32_t rawSize;
+            size_t offset;
+        };
+
+        const Entry* find (SectionId id) const;
+
+        const uint8_t* base { nullptr };
+        int version { 0 };
+        std::vector<Entry> entries;
+    };
+} // namespace PluginState
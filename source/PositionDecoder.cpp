@@ -0,0 +1,131 @@
+#include "PositionDecoder.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr int kHandReach = 3; // frets either side of the hand without shifting
+    constexpr float kShiftCost = 0.5f; // per fret beyond the reach, in nats
+    constexpr double kRelaxSeconds = 0.5; // the cost halves after this long a gap
+    constexpr float kMinProb = 1e-4f;
+} // namespace
+
+void PositionDecoder::prepare (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    reset();
+}
+
+void PositionDecoder::setLookahead (int notes)
+{
+    lookahead = std::clamp (notes, 0, kMaxLookahead);
+}
+
+void PositionDecoder::reset()
+{
+    beamSize = 0;
+    numPending = 0;
+}
+
+int PositionDecoder::push (const NoteEvent& note, int maxFret, NoteEvent* dest)
+{
+    int numOut = 0;
+    if (numPending > 0 && pending[0].tuning != note.tuning)
+    {
+        numOut = flush (dest);
+        reset();
+    }
+
+    const auto& tuning = getTuning (note.tuning);
+
+    // The further apart the notes, the more time the hand had to move
+    const float weight = beamSize > 0 ? (float) (1.0 / (1.0 + (double) (note.onsetSample - lastOnset) / (sampleRate * kRelaxSeconds))) : 0.0f;
+
+    int numExpanded = 0;
+    const Path start;
+    for (int b = 0; b < std::max (beamSize, 1) && note.isValid(); ++b)
+    {
+        const Path& from = beamSize > 0 ? beam[(size_t) b] : start;
+        for (int s = 0; s < tuning.getNumStrings(); ++s)
+        {
+            if (! tuning.isPlayable (note.f0, s, maxFret))
+                continue;
+
+            const int fret = tuning.getFret (note.f0, s, maxFret);
+            const int shift = from.handFret >= 0 && fret > 0 ? std::max (0, std::abs (fret - from.handFret) - kHandReach) : 0;
+
+            Path p = from;
+            p.score += std::log (std::max (note.stringProbs[(size_t) s], kMinProb)) - weight * kShiftCost * (float) shift;
+            p.handFret = fret > 0 ? fret : from.handFret;
+            p.strings[(size_t) numPending] = (int8_t) s;
+            p.frets[(size_t) numPending] = (int8_t) fret;
+            expanded[(size_t) numExpanded++] = p;
+        }
+    }
+
+    if (numExpanded == 0)
+    {
+        numOut += flush (dest + numOut);
+        reset();
+        dest[numOut++] = note;
+        return numOut;
+    }
+
+    std::sort (expanded.begin(), expanded.begin() + numExpanded, [] (const Path& a, const Path& b) { return a.score > b.score; });
+
+    // Paths that agree on everything still open only differ in the past, keep the best of them
+    beamSize = 0;
+    for (int i = 0; i < numExpanded && beamSize < kBeamWidth; ++i)
+    {
+        const auto& p = expanded[(size_t) i];
+        const bool duplicate = std::any_of (beam.begin(), beam.begin() + beamSize, [&] (const Path& q) {
+            return q.handFret == p.handFret && std::equal (q.strings.begin(), q.strings.begin() + numPending + 1, p.strings.begin());
+        });
+
+        if (! duplicate)
+            beam[(size_t) beamSize++] = p;
+    }
+
+    pending[(size_t) numPending++] = note;
+    lastOnset = note.onsetSample;
+
+    while (numPending > lookahead)
+        commitOldest (dest[numOut++]);
+
+    return numOut;
+}
+
+int PositionDecoder::flush (NoteEvent* dest)
+{
+    const int numOut = numPending;
+    for (int i = 0; i < numOut; ++i)
+        commitOldest (dest[i]);
+    return numOut;
+}
+
+void PositionDecoder::commitOldest (NoteEvent& dest)
+{
+    // The beam is sorted, so the front path is the most likely one
+    const int stringIdx = beam[0].strings[0];
+    dest = pending[0];
+    dest.stringIdx = stringIdx;
+    dest.fret = beam[0].frets[0];
+    dest.confidence = dest.stringProbs[(size_t) stringIdx];
+
+    // Only paths that made the same choice stay alive
+    int kept = 0;
+    for (int b = 0; b < beamSize; ++b)
+    {
+        auto p = beam[(size_t) b];
+        if (p.strings[0] != stringIdx)
+            continue;
+
+        std::rotate (p.strings.begin(), p.strings.begin() + 1, p.strings.end());
+        std::rotate (p.frets.begin(), p.frets.begin() + 1, p.frets.end());
+        beam[(size_t) kept++] = p;
+    }
+    beamSize = kept;
+
+    std::rotate (pending.begin(), pending.begin() + 1, pending.begin() + numPending);
+    --numPending;
+}
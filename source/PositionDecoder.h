@@ -0,0 +1,58 @@
+#pragma once
+
+#include "NoteEvent.h"
+#include <array>
+#include <cstdint>
+
+// ================================================================
+// Online beam decoder for the string/fret choice of consecutive single notes.
+// Each note's string probabilities are combined with a hand-position cost:
+// moving the fretting hand further than it can reach without shifting costs
+// a little per fret, less the longer the gap between the notes. A note's
+// position is only committed once `lookahead` later notes have been seen,
+// so a following note can still pull an ambiguous one onto its string.
+// Fixed beam width and fixed-size buffers, nothing allocates after prepare().
+class PositionDecoder
+{
+public:
+    static constexpr int kMaxLookahead = 2;
+    static constexpr int kBeamWidth = 8;
+    static constexpr int kMaxOutput = kMaxLookahead + 1; // what one push() can release
+
+    void prepare (double sampleRate);
+    void setLookahead (int notes);
+    void reset(); // forgets the pending notes and the hand position
+
+    // Adds a plucked single note. Writes the notes whose position is now final to
+    // dest (oldest first, at most kMaxOutput) and returns how many. Invalid notes
+    // and tuning changes flush what's pending, invalid notes then pass straight through.
+    int push (const NoteEvent& note, int maxFret, NoteEvent* dest);
+
+    // Commits everything still waiting for lookahead, keeps the hand position
+    int flush (NoteEvent* dest);
+
+    int getNumPending() const { return numPending; }
+    int64_t getLastOnset() const { return lastOnset; }
+
+private:
+    struct Path
+    {
+        float score { 0.0f };
+        int handFret { -1 }; // last fretted (non-open) position, -1 = unknown
+        std::array<int8_t, kMaxLookahead + 1> strings {}; // choice per pending note, oldest first
+        std::array<int8_t, kMaxLookahead + 1> frets {};
+    };
+
+    void commitOldest (NoteEvent& dest);
+
+    double sampleRate { 44100.0 };
+    int lookahead { 1 };
+    int64_t lastOnset { 0 };
+
+    std::array<Path, kBeamWidth> beam;
+    int beamSize { 0 };
+    std::array<Path, kBeamWidth * kMaxBassStrings> expanded;
+
+    std::array<NoteEvent, kMaxLookahead + 1> pending;
+    int numPending { 0 };
+};
@@ -0,0 +1,223 @@
+#include "SpectrumAnalyser.h"
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+namespace
+{
+    constexpr float kEps = 1e-8f;
+
+    // Parabolic interpolation around bin k, gives sub-bin peak location/magnitude
+    inline void quadraticInterp (const float* mag, int numBins, int k, float& peakBin, float& peakMag)
+    {
+        peakBin = (float) k;
+        peakMag = mag[k];
+        if (k <= 0 || k >= numBins - 1)
+            return;
+
+        const float a = mag[k - 1], b = mag[k], c = mag[k + 1];
+        const float denom = a - 2.0f * b + c;
+        if (std::abs (denom) < 1e-12f)
+            return;
+
+        const float delta = 0.5f * (a - c) / denom;
+        peakBin = (float) k + delta;
+        peakMag = b - 0.25f * (a - c) * delta;
+    }
+
+    // NaN when either amplitude is tiny/missing, so the model's imputer fills it
+    inline float safeLogRatio (float ak, float a1)
+    {
+        if (a1 <= kEps || ak <= kEps || ! std::isfinite (ak) || ! std::isfinite (a1))
+            return std::numeric_limits<float>::quiet_NaN();
+        return std::log10 (ak / a1);
+    }
+
+    inline bool isMeasured (float f) { return std::isfinite (f) && f > 0.0f; }
+} // namespace
+
+//==============================================================================
+void SpectrumAnalyser::prepare (double newSampleRate, int maxFrameLength, int zeroPad)
+{
+    sampleRate = newSampleRate;
+
+    const int order = juce::jmax (1, juce::roundToInt (std::ceil (std::log2 ((double) juce::jmax (2, maxFrameLength)))))
+                      + juce::roundToInt (std::log2 ((double) juce::jmax (1, zeroPad)));
+    fft = std::make_unique<juce::dsp::FFT> (order);
+    fftSize = fft->getSize();
+    numBins = fftSize / 2 + 1;
+    binHz = sampleRate / fftSize;
+
+    fftData.assign ((size_t) fftSize * 2, 0.0f);
+    window.assign ((size_t) maxFrameLength, 0.0f);
+    windowLength = 0;
+}
+
+void SpectrumAnalyser::compute (const float* frame, int numSamples)
+{
+    const int n = juce::jmin (numSamples, (int) window.size());
+
+    // Periodic Hann (scipy get_window(..., fftbins=True)), rebuilt only if the length changes
+    if (n != windowLength)
+    {
+        const double w = 2.0 * std::numbers::pi / n;
+        for (int i = 0; i < n; ++i)
+            window[(size_t) i] = (float) (0.5 - 0.5 * std::cos (w * i));
+        windowLength = n;
+    }
+
+    juce::FloatVectorOperations::multiply (fftData.data(), frame, window.data(), n);
+    juce::FloatVectorOperations::clear (fftData.data() + n, (int) fftData.size() - n);
+    fft->performFrequencyOnlyForwardTransform (fftData.data(), true);
+
+    // Spectral shape descriptors
+    const float* mag = fftData.data();
+    double psdSum = 0.0, weighted = 0.0, logSum = 0.0, magSum = 0.0;
+    for (int k = 0; k < numBins; ++k)
+    {
+        const double m = mag[k];
+        const double psd = m * m + 1e-12;
+        psdSum += psd;
+        weighted += k * binHz * psd;
+        logSum += std::log (m + 1e-12);
+        magSum += m + 1e-12;
+    }
+
+    shape.centroid = (float) (weighted / psdSum);
+    shape.flatness = (float) (std::exp (logSum / numBins) / (magSum / numBins));
+}
+
+HarmonicSet SpectrumAnalyser::trackHarmonics (float f0, int numHarmonics, const float* mags) const
+{
+    if (mags == nullptr)
+        mags = fftData.data();
+
+    HarmonicSet h;
+    h.count = juce::jlimit (0, kMaxHarmonics, numHarmonics);
+
+    for (int i = 0; i < h.count; ++i)
+    {
+        const double target = (i + 1) * (double) f0;
+        if (target <= 0.0 || target >= sampleRate / 2.0 - 5.0)
+        {
+            h.freqs[(size_t) i] = std::numeric_limits<float>::quiet_NaN();
+            h.amps[(size_t) i] = 0.0f;
+            continue;
+        }
+
+        const double targetBin = target / binHz;
+        const int k = juce::jlimit (1, numBins - 2, (int) std::lround (targetBin));
+
+        // Search width grows slightly with frequency to follow inharmonic stretch
+        const int searchBins = juce::jmax (3, (int) std::lround (2.0 + 0.01 * targetBin));
+        const int k0 = juce::jmax (1, k - searchBins);
+        const int k1 = juce::jmin (numBins - 2, k + searchBins);
+
+        int loc = k0;
+        for (int b = k0 + 1; b <= k1; ++b)
+            if (mags[b] > mags[loc])
+                loc = b;
+
+        float peakBin, peakMag;
+        quadraticInterp (mags, numBins, loc, peakBin, peakMag);
+        h.freqs[(size_t) i] = (float) (peakBin * binHz);
+        h.amps[(size_t) i] = peakMag;
+    }
+
+    return h;
+}
+
+//==============================================================================
+float estimateBeta (const HarmonicSet& harmonics, float f0)
+{
+    if (f0 <= 0.0f)
+        return 0.0f;
+
+    float maxWeight = 0.0f;
+    int numValid = 0;
+    for (int i = 0; i < harmonics.count; ++i)
+    {
+        if (isMeasured (harmonics.freqs[(size_t) i]))
+        {
+            maxWeight = juce::jmax (maxWeight, juce::jmax (harmonics.amps[(size_t) i], 1e-6f));
+            ++numValid;
+        }
+    }
+
+    if (numValid < 2)
+        return 0.0f;
+
+    // Single regressor n^2, so the WLS normal equation collapses to a ratio of sums
+    double num = 0.0, den = 0.0;
+    for (int i = 0; i < harmonics.count; ++i)
+    {
+        const float fn = harmonics.freqs[(size_t) i];
+        if (! isMeasured (fn))
+            continue;
+
+        const double n = i + 1;
+        const double ratio = fn / (n * f0);
+        const double w = juce::jmax (harmonics.amps[(size_t) i], 1e-6f) / maxWeight;
+        num += w * n * n * (ratio * ratio - 1.0);
+        den += w * n * n * n * n;
+    }
+
+    return (float) juce::jmax (0.0, num / den); // no negative stiffness
+}
+
+StringFeatures buildFeatures (const HarmonicSet& harmonics,
+    float f0,
+    const SpectrumShape& shape,
+    double sampleRate,
+    int numHarmonics)
+{
+    StringFeatures features {};
+    const float beta = estimateBeta (harmonics, f0);
+
+    // Residual stretch: how far measured peaks deviate from the β model
+    double residSum = 0.0, residSq = 0.0;
+    int numResid = 0;
+    for (int i = 0; i < harmonics.count; ++i)
+    {
+        const float fn = harmonics.freqs[(size_t) i];
+        if (! isMeasured (fn) || f0 <= 0.0f)
+            continue;
+
+        const double n = i + 1;
+        const double pred = n * f0 * std::sqrt (1.0 + beta * n * n);
+        const double r = (fn - pred) / (pred + 1e-9);
+        residSum += r;
+        residSq += r * r;
+        ++numResid;
+    }
+
+    const double residMean = numResid > 0 ? residSum / numResid : 0.0;
+    const double residStd = numResid > 0 ? std::sqrt (juce::jmax (0.0, residSq / numResid - residMean * residMean)) : 0.0;
+
+    // Odd/even harmonic energy ratio
+    double odd = 0.0, even = 1e-9;
+    for (int i = 0; i < harmonics.count; ++i)
+        ((i % 2) == 0 ? odd : even) += harmonics.amps[(size_t) i];
+
+    // Cap usable harmonics by Nyquist (with a small safety margin)
+    int numValid = 1;
+    if (f0 > 0.0f)
+        numValid = juce::jlimit (1, numHarmonics, (int) std::floor ((sampleRate / 2.0 - 10.0) / f0));
+
+    const float a1 = harmonics.count > 0 ? harmonics.amps[0] : 0.0f;
+    for (int k = 2; k <= 6; ++k)
+    {
+        const bool valid = k <= numValid && k - 1 < harmonics.count;
+        features[(size_t) (featureA2OverA1Log + k - 2)] = valid ? safeLogRatio (harmonics.amps[(size_t) k - 1], a1)
+                                                                : std::numeric_limits<float>::quiet_NaN();
+    }
+
+    features[featureBeta] = beta;
+    features[featureResidMean] = (float) residMean;
+    features[featureResidStd] = (float) residStd;
+    features[featureCentroid] = shape.centroid;
+    features[featureFlatness] = shape.flatness;
+    features[featureOddEvenRatio] = (float) (odd / even);
+    features[featureF0] = f0;
+    return features;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "AnalysisConfig.h"
+#include <juce_dsp/juce_dsp.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+// ================================================================
+// Harmonic tracking + inharmonicity (β) and the compact feature vector
+// the string classifier was trained on (track_harmonics_and_beta /
+// build_feature_row in the notebook).
+
+enum FeatureIndex
+{
+    featureBeta = 0,
+    featureA2OverA1Log,
+    featureA3OverA1Log,
+    featureA4OverA1Log,
+    featureA5OverA1Log,
+    featureA6OverA1Log,
+    featureResidMean,
+    featureResidStd,
+    featureCentroid,
+    featureFlatness,
+    featureOddEvenRatio,
+    featureF0,
+    kNumFeatures
+};
+
+using StringFeatures = std::array<float, kNumFeatures>;
+
+// Measured partials of one note (NaN frequency when a partial is not measurable)
+struct HarmonicSet
+{
+    std::array<float, kMaxHarmonics> freqs {};
+    std::array<float, kMaxHarmonics> amps {};
+    int count { 0 };
+};
+
+struct SpectrumShape
+{
+    float centroid { 0.0f }; // brightness
+    float flatness { 0.0f }; // tonal vs noise-like
+};
+
+class SpectrumAnalyser
+{
+public:
+    void prepare (double sampleRate, int maxFrameLength, int zeroPad);
+
+    // Hann-windowed, zero-padded magnitude spectrum of one frame
+    void compute (const float* frame, int numSamples);
+
+    const float* getMagnitudes() const { return fftData.data(); }
+    int getNumBins() const { return numBins; }
+    double getBinHz() const { return binHz; }
+    double getSampleRate() const { return sampleRate; }
+    const SpectrumShape& getShape() const { return shape; }
+
+    // Peak-picks n * f0 (n = 1..numHarmonics) with a small local search + parabolic refine.
+    // mags defaults to the last computed spectrum; multi-f0 passes its residual instead.
+    HarmonicSet trackHarmonics (float f0, int numHarmonics, const float* mags = nullptr) const;
+
+private:
+    double sampleRate { 44100.0 };
+    int fftSize { 0 };
+    int numBins { 0 };
+    double binHz { 1.0 };
+
+    std::unique_ptr<juce::dsp::FFT> fft;
+    std::vector<float> fftData;
+    std::vector<float> window;
+    int windowLength { 0 };
+    SpectrumShape shape;
+};
+
+// Weighted least squares fit of (f_n / (n f0))^2 = 1 + β n^2
+float estimateBeta (const HarmonicSet& harmonics, float f0);
+
+StringFeatures buildFeatures (const HarmonicSet& harmonics,
+    float f0,
+    const SpectrumShape& shape,
+    double sampleRate,
+    int numHarmonics);
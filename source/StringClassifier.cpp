@@ -0,0 +1,822 @@
+#include "StringClassifier.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#if BASSAID_EMBEDDED_MODEL
+    #include "EmbeddedModel.h"
+#endif
+
+namespace
+{
+    bool readFloats (const juce::var& v, std::vector<float>& dest)
+    {
+        const auto* arr = v.getArray();
+        if (arr == nullptr)
+            return false;
+
+        dest.clear();
+        dest.reserve ((size_t) arr->size());
+        for (const auto& x : *arr)
+            dest.push_back (x.isVoid() ? std::numeric_limits<float>::quiet_NaN() : (float) (double) x);
+        return true;
+    }
+
+    bool readInts (const juce::var& v, std::vector<int>& dest)
+    {
+        const auto* arr = v.getArray();
+        if (arr == nullptr)
+            return false;
+
+        dest.clear();
+        for (const auto& x : *arr)
+            dest.push_back ((int) x);
+        return true;
+    }
+
+    // Append a 2D JSON array row-by-row, checking every row has `cols` entries
+    bool readMatrix (const juce::var& v, int cols, std::vector<float>& dest, int& rows)
+    {
+        const auto* arr = v.getArray();
+        if (arr == nullptr)
+            return false;
+
+        dest.clear();
+        rows = 0;
+        std::vector<float> row;
+        for (const auto& r : *arr)
+        {
+            if (! readFloats (r, row) || (cols > 0 && (int) row.size() != cols))
+                return false;
+            dest.insert (dest.end(), row.begin(), row.end());
+            ++rows;
+        }
+        return true;
+    }
+
+    // NaNs imputed with the training medians, then standardised; dest may be raw itself
+    void scaleFeatures (const StringModel& m, const float* raw, float* dest)
+    {
+        for (size_t i = 0; i < (size_t) m.numFeatures; ++i)
+        {
+            float v = raw[i];
+            if (! std::isfinite (v))
+                v = m.imputerMedians.empty() ? m.scalerMean[i] : m.imputerMedians[i];
+            dest[i] = (v - m.scalerMean[i]) / m.scalerScale[i];
+        }
+    }
+
+    int findClass (const StringModel& m, int label)
+    {
+        const auto it = std::find (m.classLabels.begin(), m.classLabels.end(), label);
+        return it == m.classLabels.end() ? -1 : (int) (it - m.classLabels.begin());
+    }
+
+    bool readClasses (const juce::var& classes, StringModel& m, juce::String& error)
+    {
+        if (! readInts (classes, m.classLabels))
+        {
+            error = "Missing classes";
+            return false;
+        }
+
+        m.numClasses = (int) m.classLabels.size();
+        if (m.numClasses < 2 || m.numClasses > kMaxBassStrings)
+        {
+            error = "Unsupported number of classes";
+            return false;
+        }
+
+        for (auto label : m.classLabels)
+        {
+            if (label < 1 || label > kMaxBassStrings)
+            {
+                error = "Class label out of range: " + juce::String (label);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool readSvm (const juce::var& svm, StringModel& m, juce::String& error)
+    {
+        if (! readClasses (svm["classes"], m, error))
+            return false;
+
+        if (! readInts (svm["n_support"], m.classCount)
+            || ! readMatrix (svm["support_vectors"], m.numFeatures, m.supportVectors, m.numSupportVectors)
+            || ! readFloats (svm["intercept"], m.intercept))
+        {
+            error = "Missing SVM classes/support vectors/intercepts";
+            return false;
+        }
+
+        if ((int) m.classCount.size() != m.numClasses)
+        {
+            error = "Unsupported number of classes";
+            return false;
+        }
+
+        if (m.numSupportVectors > StringModel::kMaxSupportVectors)
+        {
+            error = "More than " + juce::String (StringModel::kMaxSupportVectors) + " support vectors";
+            return false;
+        }
+
+        int dualRows = 0;
+        if (! readMatrix (svm["dual_coef"], m.numSupportVectors, m.dualCoef, dualRows) || dualRows != m.numClasses - 1)
+        {
+            error = "Malformed dual_coef";
+            return false;
+        }
+
+        const int numPairs = m.numClasses * (m.numClasses - 1) / 2;
+        if ((int) m.intercept.size() != numPairs)
+        {
+            error = "Malformed intercept";
+            return false;
+        }
+
+        int start = 0;
+        for (auto count : m.classCount)
+        {
+            m.classStart.push_back (start);
+            start += count;
+        }
+        if (start != m.numSupportVectors)
+        {
+            error = "n_support does not match support vector count";
+            return false;
+        }
+
+        m.gamma = (float) (double) svm["gamma"];
+
+        // Probabilities are optional, fall back to votes when absent or malformed
+        if (! readFloats (svm["probA"], m.probA) || ! readFloats (svm["probB"], m.probB)
+            || (int) m.probA.size() != numPairs || (int) m.probB.size() != numPairs)
+        {
+            m.probA.clear();
+            m.probB.clear();
+        }
+
+        m.backend = StringModel::Backend::svm;
+        return true;
+    }
+
+    // sklearn MLPClassifier layout: coefs are (inputs x outputs) per layer
+    bool readMlp (const juce::var& mlp, StringModel& m, juce::String& error)
+    {
+        if (! readClasses (mlp["classes"], m, error))
+            return false;
+
+        const auto* coefs = mlp["coefs"].getArray();
+        const auto* intercepts = mlp["intercepts"].getArray();
+        if (coefs == nullptr || intercepts == nullptr || coefs->size() != 2 || intercepts->size() != 2)
+        {
+            error = "Only MLPs with one hidden layer are supported";
+            return false;
+        }
+
+        if (mlp.hasProperty ("activation") && mlp["activation"].toString() != "relu")
+        {
+            error = "Unsupported MLP activation: " + mlp["activation"].toString();
+            return false;
+        }
+
+        std::vector<float> hiddenBias, hiddenWeights, outputWeights;
+        int hiddenRows = 0, outputRows = 0;
+        if (! readFloats ((*intercepts)[0], hiddenBias) || ! readFloats ((*intercepts)[1], m.outputBias)
+            || hiddenBias.empty() || m.outputBias.empty()
+            || ! readMatrix ((*coefs)[0], (int) hiddenBias.size(), hiddenWeights, hiddenRows)
+            || ! readMatrix ((*coefs)[1], (int) m.outputBias.size(), outputWeights, outputRows))
+        {
+            error = "Malformed MLP coefs/intercepts";
+            return false;
+        }
+
+        m.numHidden = (int) hiddenBias.size();
+        m.numOutputs = (int) m.outputBias.size();
+        if (hiddenRows != m.numFeatures || outputRows != m.numHidden || m.numHidden > StringModel::kMaxHidden
+            || ! (m.numOutputs == m.numClasses || (m.numOutputs == 1 && m.numClasses == 2)))
+        {
+            error = "MLP layer sizes don't match the features and classes";
+            return false;
+        }
+
+        // Transposed into whole registers of hidden units, zero past numHidden
+        constexpr auto lanes = StringModel::Vec::SIMDNumElements;
+        const auto groups = (size_t) m.getNumHiddenGroups();
+        const auto zero = StringModel::Vec::expand (0.0f);
+        m.hiddenWeights.assign (groups * (size_t) m.numFeatures, zero);
+        m.hiddenBias.assign (groups, zero);
+        m.outputWeights.assign ((size_t) m.numOutputs * groups, zero);
+
+        for (size_t h = 0; h < (size_t) m.numHidden; ++h)
+        {
+            m.hiddenBias[h / lanes].set (h % lanes, hiddenBias[h]);
+            for (size_t f = 0; f < (size_t) m.numFeatures; ++f)
+                m.hiddenWeights[h / lanes * (size_t) m.numFeatures + f].set (h % lanes, hiddenWeights[f * (size_t) m.numHidden + h]);
+            for (size_t o = 0; o < (size_t) m.numOutputs; ++o)
+                m.outputWeights[o * groups + h / lanes].set (h % lanes, outputWeights[h * (size_t) m.numOutputs + o]);
+        }
+
+        m.backend = StringModel::Backend::mlp;
+        return true;
+    }
+
+    // "knn": { "classes", "k", "samples": [[raw features] per sample], "labels": [notebook label per sample] }
+    bool readKnn (const juce::var& knn, StringModel& m, juce::String& error)
+    {
+        if (! readClasses (knn["classes"], m, error))
+            return false;
+
+        std::vector<float> samples;
+        std::vector<int> labels;
+        int numSamples = 0;
+        if (! readMatrix (knn["samples"], m.numFeatures, samples, numSamples) || ! readInts (knn["labels"], labels)
+            || numSamples == 0 || (int) labels.size() != numSamples)
+        {
+            error = "Malformed k-NN samples/labels";
+            return false;
+        }
+
+        m.numNeighbours = knn.hasProperty ("k") ? (int) knn["k"] : 5;
+        if (m.numNeighbours < 1 || m.numNeighbours > KnnIndex::kMaxNeighbours)
+        {
+            error = "Unsupported k-NN k: " + juce::String (m.numNeighbours);
+            return false;
+        }
+
+        // Indexed in the same scaled space the queries are in
+        std::vector<int> classIndices ((size_t) numSamples);
+        for (size_t i = 0; i < (size_t) numSamples; ++i)
+        {
+            classIndices[i] = findClass (m, labels[i]);
+            if (classIndices[i] < 0)
+            {
+                error = "k-NN sample label not among the classes: " + juce::String (labels[i]);
+                return false;
+            }
+
+            auto* sample = samples.data() + i * (size_t) m.numFeatures;
+            scaleFeatures (m, sample, sample);
+        }
+
+        m.knnIndex.build (samples.data(), classIndices.data(), numSamples);
+        m.backend = StringModel::Backend::knn;
+        return true;
+    }
+
+    // "beta_prior": { "classes", "curves": { feature: [[intercept, slope, sigma] per class] }, "confidence" },
+    // with the features named as in the notebook. "beta" is fitted to log β, the ratios as they are.
+    bool readPrior (const juce::var& prior, StringModel& m, juce::String& error)
+    {
+        if (m.numClasses == 0)
+        {
+            if (! readClasses (prior["classes"], m, error))
+                return false;
+        }
+        else if (std::vector<int> labels; ! readInts (prior["classes"], labels) || labels != m.classLabels)
+        {
+            error = "beta_prior classes don't match the model's";
+            return false;
+        }
+
+        constexpr std::pair<const char*, int> priorFeatures[] = {
+            { "beta", featureBeta },
+            { "a2_over_a1_log", featureA2OverA1Log },
+            { "a3_over_a1_log", featureA3OverA1Log },
+            { "a4_over_a1_log", featureA4OverA1Log },
+            { "a5_over_a1_log", featureA5OverA1Log },
+            { "a6_over_a1_log", featureA6OverA1Log },
+        };
+
+        const auto curves = prior["curves"];
+        if (! curves.hasProperty ("beta"))
+        {
+            error = "beta_prior has no beta curve";
+            return false;
+        }
+
+        for (const auto& [name, feature] : priorFeatures)
+        {
+            if (! curves.hasProperty (name))
+                continue;
+
+            std::vector<float> values;
+            int rows = 0;
+            if (! readMatrix (curves[name], 3, values, rows) || rows != m.numClasses)
+            {
+                error = "Malformed beta_prior curve: " + juce::String (name);
+                return false;
+            }
+
+            StringModel::PriorTerm term;
+            term.feature = feature;
+            for (size_t c = 0; c < (size_t) rows; ++c)
+            {
+                const float sigma = values[c * 3 + 2];
+                if (! (sigma > 0.0f))
+                {
+                    error = "beta_prior spreads have to be positive";
+                    return false;
+                }
+
+                term.intercept[c] = values[c * 3];
+                term.slope[c] = values[c * 3 + 1];
+                term.invSigma[c] = 1.0f / sigma;
+                term.logSigma[c] = std::log (sigma);
+            }
+            m.priorTerms.push_back (term);
+        }
+
+        if (prior.hasProperty ("confidence"))
+            m.priorConfidence = (float) (double) prior["confidence"];
+        return true;
+    }
+
+    // libsvm sigmoid_predict, written to avoid overflow
+    inline float sigmoidPredict (float decision, float a, float b)
+    {
+        const float fApB = decision * a + b;
+        if (fApB >= 0.0f)
+            return std::exp (-fApB) / (1.0f + std::exp (-fApB));
+        return 1.0f / (1.0f + std::exp (fApB));
+    }
+
+    // libsvm multiclass_probability (Wu, Lin & Weng pairwise coupling), fixed-size
+    void couplePairwise (int k, const float r[kMaxBassStrings][kMaxBassStrings], float* p)
+    {
+        double q[kMaxBassStrings][kMaxBassStrings] {};
+        double qp[kMaxBassStrings] {};
+        const int maxIter = juce::jmax (100, k);
+        const double eps = 0.005 / k;
+
+        for (int t = 0; t < k; ++t)
+        {
+            p[t] = 1.0f / (float) k;
+            for (int j = 0; j < k; ++j)
+            {
+                if (j == t)
+                    continue;
+                q[t][t] += (double) r[j][t] * r[j][t];
+                q[t][j] = -(double) r[j][t] * r[t][j];
+            }
+        }
+
+        for (int iter = 0; iter < maxIter; ++iter)
+        {
+            double pqp = 0.0;
+            for (int t = 0; t < k; ++t)
+            {
+                qp[t] = 0.0;
+                for (int j = 0; j < k; ++j)
+                    qp[t] += q[t][j] * p[j];
+                pqp += p[t] * qp[t];
+            }
+
+            double maxError = 0.0;
+            for (int t = 0; t < k; ++t)
+                maxError = juce::jmax (maxError, std::abs (qp[t] - pqp));
+            if (maxError < eps)
+                break;
+
+            for (int t = 0; t < k; ++t)
+            {
+                const double diff = (-qp[t] + pqp) / q[t][t];
+                p[t] += (float) diff;
+                pqp = (pqp + diff * (diff * q[t][t] + 2.0 * qp[t])) / ((1.0 + diff) * (1.0 + diff));
+                for (int j = 0; j < k; ++j)
+                {
+                    qp[j] = (qp[j] + diff * q[t][j]) / (1.0 + diff);
+                    p[j] = (float) (p[j] / (1.0 + diff));
+                }
+            }
+        }
+    }
+} // namespace
+
+//==============================================================================
+std::shared_ptr<const StringModel> StringModel::fromJson (const juce::String& jsonText, juce::String& error)
+{
+    const auto json = juce::JSON::parse (jsonText);
+    if (! json.isObject())
+    {
+        error = "Model file is not valid JSON";
+        return nullptr;
+    }
+
+    auto m = std::make_shared<StringModel>();
+
+    // A prior on its own works on the raw features, no scaler needed
+    if (json.hasProperty ("beta_prior") && ! json.hasProperty ("svm") && ! json.hasProperty ("mlp") && ! json.hasProperty ("knn"))
+    {
+        m->numFeatures = kNumFeatures;
+        m->backend = StringModel::Backend::prior;
+        return readPrior (json["beta_prior"], *m, error) ? m : nullptr;
+    }
+
+    const auto scaler = json["scaler"];
+
+    if (! readFloats (scaler["mean"], m->scalerMean) || ! readFloats (scaler["scale"], m->scalerScale))
+    {
+        error = "Missing scaler mean/scale";
+        return nullptr;
+    }
+
+    m->numFeatures = (int) m->scalerMean.size();
+    if (m->numFeatures != kNumFeatures || (int) m->scalerScale.size() != kNumFeatures)
+    {
+        error = "Model expects " + juce::String (m->numFeatures) + " features, plugin computes " + juce::String (kNumFeatures);
+        return nullptr;
+    }
+
+    if (json.hasProperty ("imputer"))
+        readFloats (json["imputer"]["statistics"], m->imputerMedians);
+
+    const bool ok = json.hasProperty ("mlp")   ? readMlp (json["mlp"], *m, error)
+                    : json.hasProperty ("knn") ? readKnn (json["knn"], *m, error)
+                                               : readSvm (json["svm"], *m, error);
+    if (! ok || (json.hasProperty ("beta_prior") && ! readPrior (json["beta_prior"], *m, error)))
+        return nullptr;
+
+    return m;
+}
+
+std::shared_ptr<const StringModel> StringModel::fromFile (const juce::File& file, juce::String& error)
+{
+    if (! file.existsAsFile())
+    {
+        error = "No model at " + file.getFullPathName();
+        return nullptr;
+    }
+
+    return fromJson (file.loadFileAsString(), error);
+}
+
+juce::File StringModel::getDefaultModelFile (int tuningIndex)
+{
+    const auto dir = juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory).getChildFile ("BassAid");
+    const auto file = dir.getChildFile ("svm_" + juce::String (kTuningDescriptors[(size_t) tuningIndex].id) + ".json");
+
+    if (tuningIndex == tuningStandard4 && ! file.existsAsFile())
+        return dir.getChildFile ("svm_export_for_juce.json");
+
+    return file;
+}
+
+std::shared_ptr<const StringModel> StringModel::withSamples (const StringFeatures* samples, const int* labels, int numSamples) const
+{
+    if (backend != Backend::knn)
+        return nullptr;
+
+    // The index takes them as they are, nothing is refitted
+    auto m = std::make_shared<StringModel> (*this);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const int c = findClass (*m, labels[i]);
+        if (c < 0)
+            continue;
+
+        StringFeatures sample;
+        scaleFeatures (*m, samples[i].data(), sample.data());
+        m->knnIndex.append (sample.data(), c);
+    }
+    return m;
+}
+
+bool StringModel::fitsTuning (const BassTuning& tuning) const
+{
+    for (auto label : classLabels)
+        if (label > tuning.getNumStrings())
+            return false;
+    return true;
+}
+
+StringModelSlots loadDefaultModels()
+{
+    StringModelSlots slots;
+    for (int t = 0; t < kNumTunings; ++t)
+    {
+        const auto file = StringModel::getDefaultModelFile (t);
+        if (! file.existsAsFile())
+        {
+           #if BASSAID_EMBEDDED_MODEL
+            // The compiled-in production model, unless the user exported their own
+            if (t == EmbeddedModel::kTuning)
+                slots[(size_t) t] = makeFixedStringModel<EmbeddedModel::kModel>();
+           #endif
+            continue;
+        }
+
+        juce::String error;
+        auto model = StringModel::fromFile (file, error);
+
+        if (model != nullptr && ! model->fitsTuning (getTuning (t)))
+        {
+            error = "Model has more strings than " + juce::String (kTuningDescriptors[(size_t) t].name);
+            model = nullptr;
+        }
+
+        if (error.isNotEmpty())
+            DBG (error);
+
+        slots[(size_t) t] = std::move (model);
+    }
+    return slots;
+}
+
+//==============================================================================
+StringClassifier::StringClassifier()
+    : scaled ((size_t) kNumFeatures),
+      kernel ((size_t) StringModel::kMaxSupportVectors),
+      hidden ((size_t) (StringModel::kMaxHidden / (int) StringModel::Vec::SIMDNumElements))
+{
+}
+
+void StringClassifier::setModel (const StringModel* newModel)
+{
+    // fromJson() only accepts models that fit the scratch
+    jassert (newModel == nullptr
+             || (newModel->numFeatures <= (int) scaled.size() && newModel->numSupportVectors <= (int) kernel.size()
+                 && newModel->getNumHiddenGroups() <= (int) hidden.size()));
+    model = newModel;
+}
+
+StringPrediction StringClassifier::predict (const StringFeatures& features, const BassTuning& tuning, int maxFret)
+{
+    StringPrediction result;
+    const float f0 = features[featureF0];
+
+    // Without a model, fall back to a soft preference for low positions
+    if (model == nullptr)
+    {
+        float total = 0.0f;
+        for (int s = 0; s < tuning.getNumStrings(); ++s)
+            if (tuning.isPlayable (f0, s, maxFret))
+                total += result.probs[(size_t) s] = std::exp (-(float) tuning.getFret (f0, s, maxFret) / 5.0f);
+
+        for (int s = 0; s < tuning.getNumStrings() && total > 0.0f; ++s)
+        {
+            result.probs[(size_t) s] /= total;
+            if (result.stringIdx < 0 || result.probs[(size_t) s] > result.probs[(size_t) result.stringIdx])
+                result.stringIdx = s;
+        }
+        return result;
+    }
+
+    const auto& m = *model;
+
+    // Only strings that can play f0 within 0..maxFret are worth evaluating; when
+    // that's a single string (e.g. anything below A1 on a 4-string) the model is skipped
+    int candidates[kMaxBassStrings] {}; // class indices
+    int numCandidates = 0;
+    for (int c = 0; c < m.numClasses; ++c)
+        if (tuning.isPlayable (f0, m.classLabels[(size_t) c] - 1, maxFret))
+            candidates[numCandidates++] = c;
+
+    if (numCandidates == 1)
+    {
+        result.stringIdx = m.classLabels[(size_t) candidates[0]] - 1;
+        result.probs[(size_t) result.stringIdx] = 1.0f;
+        return result;
+    }
+
+    // Nothing fits (f0 off the fretboard), leave it to the model
+    if (numCandidates == 0)
+        for (int c = 0; c < m.numClasses; ++c)
+            candidates[numCandidates++] = c;
+
+    // The prior is a few flops per candidate, a clear winner there saves running the model
+    float candidateProbs[kMaxBassStrings] {};
+    const bool settledByPrior = ! m.priorTerms.empty()
+                                && (predictPrior (features, tuning, maxFret, candidates, numCandidates, candidateProbs) >= m.priorConfidence
+                                    || m.backend == StringModel::Backend::prior);
+
+    if (! settledByPrior)
+    {
+        // Compiled-in models do their own scaling
+        if (m.fixedDecisions == nullptr)
+            scaleFeatures (m, features.data(), scaled.data());
+
+        if (m.backend == StringModel::Backend::mlp)
+            predictMlp (candidates, numCandidates, candidateProbs);
+        else if (m.backend == StringModel::Backend::knn)
+            predictKnn (candidates, numCandidates, candidateProbs);
+        else
+            predictSvm (features, candidates, numCandidates, candidateProbs);
+    }
+
+    int best = 0;
+    for (int c = 0; c < numCandidates; ++c)
+    {
+        result.probs[(size_t) m.classLabels[(size_t) candidates[c]] - 1] = candidateProbs[c];
+        if (candidateProbs[c] > candidateProbs[best])
+            best = c;
+    }
+
+    result.stringIdx = m.classLabels[(size_t) candidates[best]] - 1;
+    return result;
+}
+
+float StringClassifier::predictPrior (const StringFeatures& features, const BassTuning& tuning, int maxFret,
+                                      const int* candidates, int numCandidates, float* candidateProbs) const
+{
+    const auto& m = *model;
+
+    // Unmeasured features (β of 0 included) drop out of every candidate's score alike
+    const float logBeta = std::log (features[featureBeta]);
+
+    float logLikelihood[kMaxBassStrings] {};
+    float maxLog = -std::numeric_limits<float>::max();
+    for (int i = 0; i < numCandidates; ++i)
+    {
+        const auto c = (size_t) candidates[i];
+        const auto fret = (float) tuning.getFret (features[featureF0], m.classLabels[c] - 1, maxFret);
+
+        for (const auto& term : m.priorTerms)
+        {
+            const float x = term.feature == featureBeta ? logBeta : features[(size_t) term.feature];
+            if (! std::isfinite (x))
+                continue;
+
+            const float z = (x - (term.intercept[c] + term.slope[c] * fret)) * term.invSigma[c];
+            logLikelihood[i] -= 0.5f * z * z + term.logSigma[c];
+        }
+
+        maxLog = juce::jmax (maxLog, logLikelihood[i]);
+    }
+
+    float total = 0.0f;
+    for (int i = 0; i < numCandidates; ++i)
+        total += candidateProbs[i] = std::exp (logLikelihood[i] - maxLog);
+
+    float best = 0.0f;
+    for (int i = 0; i < numCandidates; ++i)
+        best = juce::jmax (best, candidateProbs[i] /= total);
+    return best;
+}
+
+void StringClassifier::predictSvm (const StringFeatures& features, const int* candidates, int numCandidates, float* candidateProbs)
+{
+    const auto& m = *model;
+
+    int slot[kMaxBassStrings];
+    bool isCandidate[kMaxBassStrings] {};
+    std::fill_n (slot, kMaxBassStrings, -1);
+    for (int i = 0; i < numCandidates; ++i)
+    {
+        slot[candidates[i]] = i;
+        isCandidate[candidates[i]] = true;
+    }
+
+    float decisions[kMaxBassStrings * (kMaxBassStrings - 1) / 2] {};
+    if (m.fixedDecisions != nullptr)
+        m.fixedDecisions (features, isCandidate, decisions);
+    else
+        computeDecisions (isCandidate, decisions);
+
+    // One-vs-one votes and probabilities (libsvm layout), only for pairs of candidates
+    const bool withProbs = ! m.probA.empty();
+    float pairwise[kMaxBassStrings][kMaxBassStrings] {};
+    int votes[kMaxBassStrings] {};
+    int numPairs = 0;
+    int p = 0;
+    for (int i = 0; i < m.numClasses; ++i)
+    {
+        for (int j = i + 1; j < m.numClasses; ++j, ++p)
+        {
+            if (slot[i] < 0 || slot[j] < 0)
+                continue;
+
+            const float decision = decisions[p];
+            ++votes[decision > 0.0f ? slot[i] : slot[j]];
+            ++numPairs;
+
+            if (withProbs)
+            {
+                const float r = juce::jlimit (1e-7f, 1.0f - 1e-7f, sigmoidPredict (decision, m.probA[(size_t) p], m.probB[(size_t) p]));
+                pairwise[slot[i]][slot[j]] = r;
+                pairwise[slot[j]][slot[i]] = 1.0f - r;
+            }
+        }
+    }
+
+    if (withProbs)
+        couplePairwise (numCandidates, pairwise, candidateProbs);
+    else
+        for (int c = 0; c < numCandidates; ++c)
+            candidateProbs[c] = (float) votes[c] / (float) numPairs;
+}
+
+void StringClassifier::computeDecisions (const bool* isCandidate, float* decisions)
+{
+    const auto& m = *model;
+
+    // RBF kernel against the support vectors of the candidate classes
+    for (int c = 0; c < m.numClasses; ++c)
+    {
+        if (! isCandidate[c])
+            continue;
+
+        for (int sv = m.classStart[(size_t) c], e = sv + m.classCount[(size_t) c]; sv < e; ++sv)
+        {
+            const float* z = m.supportVectors.data() + (size_t) sv * (size_t) m.numFeatures;
+            float dist = 0.0f;
+            for (int f = 0; f < m.numFeatures; ++f)
+            {
+                const float d = scaled[(size_t) f] - z[f];
+                dist += d * d;
+            }
+            kernel[(size_t) sv] = std::exp (-m.gamma * dist);
+        }
+    }
+
+    int p = 0;
+    for (int i = 0; i < m.numClasses; ++i)
+    {
+        for (int j = i + 1; j < m.numClasses; ++j, ++p)
+        {
+            if (! isCandidate[i] || ! isCandidate[j])
+                continue;
+
+            const float* coefI = m.dualCoef.data() + (size_t) (j - 1) * (size_t) m.numSupportVectors;
+            const float* coefJ = m.dualCoef.data() + (size_t) i * (size_t) m.numSupportVectors;
+
+            float decision = m.intercept[(size_t) p];
+            for (int k = m.classStart[(size_t) i], e = k + m.classCount[(size_t) i]; k < e; ++k)
+                decision += coefI[k] * kernel[(size_t) k];
+            for (int k = m.classStart[(size_t) j], e = k + m.classCount[(size_t) j]; k < e; ++k)
+                decision += coefJ[k] * kernel[(size_t) k];
+            decisions[p] = decision;
+        }
+    }
+}
+
+void StringClassifier::predictMlp (const int* candidates, int numCandidates, float* candidateProbs)
+{
+    using Vec = StringModel::Vec;
+    const auto& m = *model;
+    const auto groups = (size_t) m.getNumHiddenGroups();
+    const auto zero = Vec::expand (0.0f);
+
+    // Hidden layer one register of units at a time: the accumulator stays in a
+    // register over the features, the ReLU is applied on the way out
+    for (size_t g = 0; g < groups; ++g)
+    {
+        const auto* w = m.hiddenWeights.data() + g * (size_t) m.numFeatures;
+        auto acc = m.hiddenBias[g];
+        for (int f = 0; f < m.numFeatures; ++f)
+            acc = Vec::multiplyAdd (acc, w[f], Vec::expand (scaled[(size_t) f]));
+        hidden[g] = Vec::max (acc, zero);
+    }
+
+    const auto output = [&] (int o) {
+        const auto* w = m.outputWeights.data() + (size_t) o * groups;
+        auto acc = zero;
+        for (size_t g = 0; g < groups; ++g)
+            acc = Vec::multiplyAdd (acc, w[g], hidden[g]);
+        return m.outputBias[(size_t) o] + acc.sum();
+    };
+
+    // Softmax over the candidates only; a single logistic output is the second class's logit against 0
+    const float binaryLogit = m.numOutputs == 1 ? output (0) : 0.0f;
+    float logits[kMaxBassStrings] {};
+    float maxLogit = -std::numeric_limits<float>::max();
+    for (int i = 0; i < numCandidates; ++i)
+    {
+        logits[i] = m.numOutputs == 1 ? (candidates[i] == 1 ? binaryLogit : 0.0f) : output (candidates[i]);
+        maxLogit = juce::jmax (maxLogit, logits[i]);
+    }
+
+    float total = 0.0f;
+    for (int i = 0; i < numCandidates; ++i)
+        total += candidateProbs[i] = std::exp (logits[i] - maxLogit);
+
+    for (int i = 0; i < numCandidates; ++i)
+        candidateProbs[i] /= total;
+}
+
+void StringClassifier::predictKnn (const int* candidates, int numCandidates, float* candidateProbs) const
+{
+    const auto& m = *model;
+
+    int slot[kMaxBassStrings] {};
+    bool isCandidate[kMaxBassStrings] {};
+    for (int i = 0; i < numCandidates; ++i)
+    {
+        slot[candidates[i]] = i;
+        isCandidate[candidates[i]] = true;
+    }
+
+    // One vote per neighbour, among the candidates' samples only
+    KnnIndex::Neighbour neighbours[KnnIndex::kMaxNeighbours];
+    const int numFound = m.knnIndex.search (scaled.data(), m.numNeighbours, isCandidate, neighbours);
+
+    for (int i = 0; i < numFound; ++i)
+        candidateProbs[slot[neighbours[i].classIndex]] += 1.0f / (float) numFound;
+
+    for (int c = 0; c < numCandidates && numFound == 0; ++c)
+        candidateProbs[c] = 1.0f / (float) numCandidates;
+}
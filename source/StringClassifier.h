@@ -0,0 +1,156 @@
+#pragma once
+
+#include "BassTuning.h"
+#include "KnnIndex.h"
+#include "SpectrumAnalyser.h"
+#include <juce_core/juce_core.h>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+// ================================================================
+// Exported string classifier (svm_export_for_juce.json): the notebook's
+// scaler/imputer in front of an RBF-SVM, a small MLP or a k-NN index over the
+// training set, whichever the file carries. The SVM's cost grows with its
+// support vectors, the MLP's is fixed by its topology (12 -> 32 -> 4 is about
+// a thousand flops) and k-NN's grows with the log of its samples.
+// An optional physics prior in front of either decides the clear-cut notes
+// for a few flops, or makes up the whole model.
+// Immutable once loaded, so it can be shared freely between threads.
+struct StringModel
+{
+    enum class Backend
+    {
+        svm,
+        mlp,
+        knn,
+        prior // the physics prior on its own
+    };
+
+    // MLP weights are packed in whole SIMD registers of hidden units
+    using Vec = juce::dsp::SIMDRegister<float>;
+    static constexpr int kMaxHidden = 256;
+
+    // Larger SVMs are rejected at load, so a classifier's scratch can be sized once
+    static constexpr int kMaxSupportVectors = 8192;
+
+    Backend backend { Backend::svm };
+    int numFeatures { 0 };
+    int numClasses { 0 };
+    int numSupportVectors { 0 };
+
+    std::vector<int> classLabels; // notebook labels, 1 = E ... 4 = G
+    std::vector<float> scalerMean;
+    std::vector<float> scalerScale;
+    std::vector<float> imputerMedians; // empty when the pipeline had no imputer
+
+    float gamma { 1.0f };
+    std::vector<float> supportVectors; // numSupportVectors x numFeatures, row-major, scaled space
+    std::vector<int> classStart; // first support vector of each class
+    std::vector<int> classCount; // support vectors per class
+    std::vector<float> dualCoef; // (numClasses - 1) x numSupportVectors
+    std::vector<float> intercept; // one per OvO pair
+    std::vector<float> probA; // Platt scaling, empty when exported without probabilities
+    std::vector<float> probB;
+
+    // MLP: one ReLU hidden layer, softmax over the classes (a single logistic
+    // output for two classes, as sklearn exports it). Padding lanes are zero.
+    int numHidden { 0 };
+    int numOutputs { 0 };
+    std::vector<Vec> hiddenWeights; // hidden groups x numFeatures
+    std::vector<Vec> hiddenBias; // hidden groups
+    std::vector<Vec> outputWeights; // numOutputs x hidden groups
+    std::vector<float> outputBias;
+
+    // k-NN: votes of the numNeighbours nearest training samples of the candidate
+    // classes, in scaled space. More samples can be added without retraining.
+    int numNeighbours { 0 };
+    KnnIndex knnIndex;
+
+    // A model compiled into the plugin (FixedStringModel.h) computes the SVM's
+    // one-vs-one decisions itself; of the above only the class labels and Platt
+    // pairs are set then
+    using FixedDecisions = void (*) (const StringFeatures& features, const bool* isCandidate, float* decisions);
+    FixedDecisions fixedDecisions { nullptr };
+
+    // Physics prior: β ∝ 1/L², so on each string log β rises by about ln 2 / 6
+    // per fret, and the low harmonic ratios drift with the fret too. Every term
+    // is one feature's expected value per class as a line over the fret that f0
+    // implies on that string, with its spread. Strings are scored by the
+    // Gaussian likelihood of the measured values, and only when none reaches
+    // priorConfidence does the SVM or MLP run.
+    struct PriorTerm
+    {
+        int feature { featureBeta }; // β is compared in log
+        std::array<float, kMaxBassStrings> intercept {}; // per class
+        std::array<float, kMaxBassStrings> slope {};
+        std::array<float, kMaxBassStrings> invSigma {};
+        std::array<float, kMaxBassStrings> logSigma {};
+    };
+
+    std::vector<PriorTerm> priorTerms; // empty without a "beta_prior" section
+    float priorConfidence { 0.9f };
+
+    int getNumHiddenGroups() const { return (numHidden + (int) Vec::SIMDNumElements - 1) / (int) Vec::SIMDNumElements; }
+
+    // A copy of a k-NN model with more labelled samples (raw features, notebook
+    // labels), e.g. recorded while calibrating to a player's bass. Samples with
+    // labels the model doesn't know are skipped. nullptr for other backends.
+    std::shared_ptr<const StringModel> withSamples (const StringFeatures* samples, const int* labels, int numSamples) const;
+
+    static std::shared_ptr<const StringModel> fromJson (const juce::String& jsonText, juce::String& error);
+    static std::shared_ptr<const StringModel> fromFile (const juce::File& file, juce::String& error);
+
+    // Where a user-exported model for a tuning is picked up from by default
+    // (svm_<tuning id>.json, plus the notebook's original file name for standard 4-string)
+    static juce::File getDefaultModelFile (int tuningIndex);
+
+    // True when every class label is a string that exists in this tuning
+    bool fitsTuning (const BassTuning& tuning) const;
+};
+
+// One model slot per tuning, empty slots use the heuristic fallback
+using StringModelSlots = std::array<std::shared_ptr<const StringModel>, kNumTunings>;
+
+// Loads every tuning's default model file that exists. Message thread only.
+StringModelSlots loadDefaultModels();
+
+struct StringPrediction
+{
+    int stringIdx { -1 }; // 0 = lowest string
+    std::array<float, kMaxBassStrings> probs {};
+};
+
+// Runs the physics prior, then when that's ambiguous scaler -> imputer ->
+// OvO RBF-SVM -> Platt coupling, the MLP's forward pass or the k-NN search,
+// without allocating.
+class StringClassifier
+{
+public:
+    // Sizes the scratch for the largest model that loads, so setModel() never
+    // allocates, even when it runs on the audio thread in inline mode
+    StringClassifier();
+
+    // Not owned, whoever hands it over keeps it alive until the next setModel()
+    void setModel (const StringModel* newModel);
+    bool hasModel() const { return model != nullptr; }
+
+    StringPrediction predict (const StringFeatures& features, const BassTuning& tuning, int maxFret);
+
+private:
+    // Fills one probability per candidate class from the prior, returns the highest
+    float predictPrior (const StringFeatures& features, const BassTuning& tuning, int maxFret,
+                        const int* candidates, int numCandidates, float* candidateProbs) const;
+
+    // Both fill one probability per candidate class from the scaled features
+    void predictSvm (const StringFeatures& features, const int* candidates, int numCandidates, float* candidateProbs);
+    void predictMlp (const int* candidates, int numCandidates, float* candidateProbs);
+    void predictKnn (const int* candidates, int numCandidates, float* candidateProbs) const;
+    void computeDecisions (const bool* isCandidate, float* decisions); // loaded SVM, on the scaled features
+
+    const StringModel* model { nullptr };
+    std::vector<float> scaled;
+    std::vector<float> kernel;
+    std::vector<StringModel::Vec> hidden;
+};
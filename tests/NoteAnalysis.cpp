@@ -0,0 +1,866 @@
+#include "helpers/synthetic_bass.h"
+#include <AnalysisEngine.h>
+#include <Decimator.h>
+#include <HumFilter.h>
+#include <KnnIndex.h>
+#include <NoteAnalyser.h>
+#include <OctaveCorrection.h>
+#include <PitchTracker.h>
+#include <PositionDecoder.h>
+#include <TinySvmModel.h>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
+#include <numeric>
+
+namespace
+{
+    constexpr double kSampleRate = 44100.0;
+
+    // The post-attack window the analysis engine would hand over
+    std::vector<float> sustainWindow (const std::vector<float>& note, const AnalysisConfig& config)
+    {
+        const auto start = (size_t) config.getStartSamples (kSampleRate);
+        const auto length = (size_t) config.getWindowSamples (kSampleRate);
+        return { note.begin() + (long) start, note.begin() + (long) (start + length) };
+    }
+} // namespace
+
+TEST_CASE ("Fret mapping", "[tuning]")
+{
+    for (int t = 0; t < kNumTunings; ++t)
+    {
+        const auto& tuning = getTuning (t);
+        for (int s = 0; s < tuning.getNumStrings(); ++s)
+            for (int fret = 0; fret <= kMaxFretLimit; ++fret)
+                CHECK (tuning.getFret (tuning.getFretFreq (s, fret), s) == fret);
+    }
+
+    // The tables are built at compile time
+    STATIC_REQUIRE (getTuning (tuningStandard4).getFretFreq (1, 12) > 109.999);
+    STATIC_REQUIRE (getTuning (tuningStandard4).getFretFreq (1, 12) < 110.001);
+
+    SECTION ("SVMs too big for the classifier's scratch are rejected")
+    {
+        const int numSupportVectors = StringModel::kMaxSupportVectors + 1;
+        juce::StringArray rows, coefs;
+        for (int i = 0; i < numSupportVectors; ++i)
+        {
+            rows.add ("[0,0,0,0,0,0,0,0,0,0,0,0]");
+            coefs.add ("0");
+        }
+
+        const auto coefRow = "[" + coefs.joinIntoString (",") + "]";
+        const auto big = R"({
+            "scaler": { "mean": [0,0,0,0,0,0,0,0,0,0,0,100], "scale": [1,1,1,1,1,1,1,1,1,1,1,50] },
+            "svm": {
+                "classes": [1,2,3,4], "n_support": [)" + juce::String (numSupportVectors - 3) + R"(,1,1,1], "gamma": 0.5,
+                "support_vectors": [)" + rows.joinIntoString (",") + R"(],
+                "dual_coef": [)" + coefRow + "," + coefRow + "," + coefRow + R"(],
+                "intercept": [0,0,0,0,0,0]
+            }
+        })";
+
+        CHECK (StringModel::fromJson (big, error) == nullptr);
+        CHECK (error.startsWith ("More than"));
+    }
+
+    SECTION ("notes below A1 only fit on the E string")
+    {
+        const auto& standard = getTuning (tuningStandard4);
+        CHECK (standard.isPlayable (standard.getFretFreq (0, 3), 0));
+        CHECK_FALSE (standard.isPlayable (standard.getFretFreq (0, 3), 1));
+    }
+
+    SECTION ("max fret limits the playable range")
+    {
+        const auto& standard = getTuning (tuningStandard4);
+        CHECK (standard.isPlayable (standard.getFretFreq (0, 12), 0, 12));
+        CHECK_FALSE (standard.isPlayable (standard.getFretFreq (0, 13), 0, 12));
+    }
+
+    SECTION ("alternate tunings")
+    {
+        CHECK_THAT (getTuning (tuningDropD4).getOpenFreq (0), Catch::Matchers::WithinRel (36.708, 1e-4));
+        CHECK_THAT (getTuning (tuningStandard5).getOpenFreq (0), Catch::Matchers::WithinRel (30.868, 1e-4));
+        CHECK (getTuning (tuningStandard6).getNumStrings() == 6);
+        CHECK (getTuning (tuningBEAD4).getOpenMidi (3) == 38);
+    }
+}
+
+TEST_CASE ("YIN f0 estimation", "[pitch]")
+{
+    AnalysisConfig config;
+    YinPitchDetector yin;
+    yin.prepare (kSampleRate, config.getWindowSamples (kSampleRate), config.fMin, config.fMax);
+
+    for (const double f0 : { 41.2034, 55.0, 98.0, 196.0, 330.0 })
+    {
+        const auto frame = sustainWindow (makeBassNote (kSampleRate, f0, 0.3), config);
+        CHECK_THAT (yin.estimate (frame.data(), (int) frame.size()), Catch::Matchers::WithinRel (f0, 0.01));
+    }
+}
+
+TEST_CASE ("Pitch estimator backends", "[pitch]")
+{
+    AnalysisConfig config;
+    const auto windowSamples = config.getWindowSamples (kSampleRate);
+
+    SpectrumAnalyser spectrum;
+    spectrum.prepare (kSampleRate, windowSamples, config.zeroPad);
+
+    // One arena for all of them, as in the analyser
+    PitchScratch scratch;
+    YinPitchDetector yin;
+    yin.prepare (kSampleRate, windowSamples, config.fMin, config.fMax, &scratch);
+    McLeodPitchDetector mpm;
+    mpm.prepare (kSampleRate, windowSamples, config.fMin, config.fMax, &scratch);
+    HpsPitchDetector hps;
+    hps.prepare (kSampleRate, spectrum.getNumBins(), windowSamples, config.fMin, config.fMax, &scratch);
+
+    for (const double f0 : { 41.2034, 55.0, 98.0, 196.0, 330.0 })
+    {
+        const auto frame = sustainWindow (makeBassNote (kSampleRate, f0, 0.3), config);
+        spectrum.compute (frame.data(), (int) frame.size());
+
+        CHECK_THAT (mpm.estimate (frame.data(), (int) frame.size()), Catch::Matchers::WithinRel (f0, 0.01));
+        CHECK (mpm.getLastAperiodicity() < 0.1f);
+        CHECK_THAT (hps.estimate (spectrum.getMagnitudes()), Catch::Matchers::WithinRel (f0, 0.01));
+
+        // Sharing scratch doesn't disturb the others
+        CHECK_THAT (yin.estimate (frame.data(), (int) frame.size()), Catch::Matchers::WithinRel (f0, 0.01));
+    }
+
+    SECTION ("the analyser runs the configured backend")
+    {
+        for (const auto backend : { PitchBackend::mpm, PitchBackend::hps })
+        {
+            config.pitchBackend = backend;
+            NoteAnalyser analyser;
+            analyser.prepare (kSampleRate, config);
+
+            const auto frame = sustainWindow (makeBassNote (kSampleRate, 73.4162, 0.3), config);
+            NoteEvent event;
+            REQUIRE (analyser.analyse (frame.data(), (int) frame.size(), AnalysisSettings {}, &event) == 1);
+            CHECK_THAT (event.f0, Catch::Matchers::WithinRel (73.4162, 0.01));
+        }
+    }
+}
+
+TEST_CASE ("Decimated f0 path", "[pitch]")
+{
+    AnalysisConfig config;
+    Decimator decimator;
+    decimator.prepare (kSampleRate, config.f0SampleRate);
+    REQUIRE (decimator.getFactor() == 8);
+
+    YinPitchDetector yin;
+    yin.prepare (decimator.getOutputRate(), config.getWindowSamples (kSampleRate) / 8, config.fMin, config.fMax);
+
+    PyramidPitchDetector pyramid;
+    pyramid.prepare (decimator.getOutputRate(), config.getWindowSamples (kSampleRate) / 8, config.fMin, config.fMax);
+
+    for (const double f0 : { 41.2034, 55.0, 98.0, 196.0, 392.0 })
+    {
+        auto note = makeBassNote (kSampleRate, f0, 0.3);
+        const int numLow = decimator.process (note.data(), (int) note.size(), note.data());
+        decimator.reset();
+
+        // Same span as the full-rate sustain window, shifted by the filter delay
+        const auto start = (config.getStartSamples (kSampleRate) + decimator.getLatency()) / 8;
+        const auto length = config.getWindowSamples (kSampleRate) / 8;
+        REQUIRE (start + length <= numLow);
+        CHECK_THAT (yin.estimate (note.data() + start, length), Catch::Matchers::WithinRel (f0, 0.01));
+
+        // The coarse-to-fine search lands on the same period
+        CHECK_THAT (pyramid.estimate (note.data() + start, length), Catch::Matchers::WithinRel (f0, 0.01));
+        CHECK (pyramid.getLastAperiodicity() < 0.1f);
+    }
+}
+
+TEST_CASE ("Harmonic tracking recovers inharmonicity", "[features]")
+{
+    AnalysisConfig config;
+    SpectrumAnalyser spectrum;
+    spectrum.prepare (kSampleRate, config.getWindowSamples (kSampleRate), config.zeroPad);
+
+    const double beta = 4.0e-4;
+    const auto frame = sustainWindow (makeBassNote (kSampleRate, 55.0, 0.3, beta), config);
+    spectrum.compute (frame.data(), (int) frame.size());
+
+    const auto harmonics = spectrum.trackHarmonics (55.0f, config.numHarmonics);
+    CHECK_THAT (estimateBeta (harmonics, 55.0f), Catch::Matchers::WithinRel (beta, 0.25));
+
+    const auto features = buildFeatures (harmonics, 55.0f, spectrum.getShape(), kSampleRate, config.numHarmonics);
+    CHECK (features[featureA2OverA1Log] < 0.0f); // 1/n roll-off
+    CHECK (features[featureF0] == 55.0f);
+}
+
+TEST_CASE ("Octave correction", "[pitch]")
+{
+    AnalysisConfig config;
+    SpectrumAnalyser spectrum;
+    spectrum.prepare (kSampleRate, config.getWindowSamples (kSampleRate), config.zeroPad);
+
+    const auto& standard = getTuning (tuningStandard4);
+    const auto correct = [&] (float f0) { return correctOctave (spectrum, f0, standard, kDefaultMaxFret, config.octaveSwitchRatio); };
+
+    for (const double f0 : { 55.0, 73.4162, 98.0, 146.832 })
+    {
+        const auto frame = sustainWindow (makeBassNote (kSampleRate, f0, 0.3), config);
+        spectrum.compute (frame.data(), (int) frame.size());
+
+        CHECK_THAT (correct ((float) f0), Catch::Matchers::WithinRel (f0, 1e-6));
+        CHECK_THAT (correct ((float) f0 * 2.0f), Catch::Matchers::WithinRel (f0, 1e-6));
+        CHECK_THAT (correct ((float) f0 * 0.5f), Catch::Matchers::WithinRel (f0, 1e-6));
+    }
+
+    SECTION ("an unplayable estimate moves to a playable octave")
+    {
+        // Low B only exists on a 5-string, a 4-string can only have played the octave
+        const auto frame = sustainWindow (makeBassNote (kSampleRate, 30.8677, 0.3), config);
+        spectrum.compute (frame.data(), (int) frame.size());
+        CHECK_THAT (correct (30.8677f), Catch::Matchers::WithinRel (61.7354, 1e-4));
+    }
+}
+
+TEST_CASE ("String candidate pruning", "[classifier]")
+{
+    // A tiny 4-string model: one support vector per string, Platt scaling on
+    const auto json = R"({
+        "scaler": { "mean": [0,0,0,0,0,0,0,0,0,0,0,100], "scale": [1,1,1,1,1,1,1,1,1,1,1,50] },
+        "svm": {
+            "classes": [1,2,3,4], "n_support": [1,1,1,1], "gamma": 0.5,
+            "support_vectors": [[0,0,0,0,0,0,0,0,0,0,0,-1], [1,0,0,0,0,0,0,0,0,0,0,0], [2,0,0,0,0,0,0,0,0,0,0,1], [3,0,0,0,0,0,0,0,0,0,0,2]],
+            "dual_coef": [[1,-1,-0.5,-0.5], [0.5,1,-1,-0.5], [0.5,0.5,1,-1]],
+            "intercept": [0.1,0.2,0.3,-0.1,0.1,0.2],
+            "probA": [-2,-2,-2,-2,-2,-2], "probB": [0,0,0,0,0,0]
+        }
+    })";
+
+    juce::String error;
+    const auto model = StringModel::fromJson (json, error);
+    REQUIRE (model != nullptr);
+
+    StringClassifier classifier;
+    classifier.setModel (model.get());
+    const auto& standard = getTuning (tuningStandard4);
+
+    const auto predict = [&] (float f0, int maxFret) {
+        StringFeatures features {};
+        features[featureF0] = f0;
+        return classifier.predict (features, standard, maxFret);
+    };
+
+    const auto sum = [] (const StringPrediction& p) { return std::accumulate (p.probs.begin(), p.probs.end(), 0.0f); };
+
+    SECTION ("notes below A1 only fit on the E string")
+    {
+        const auto p = predict (43.6535f, kDefaultMaxFret);
+        CHECK (p.stringIdx == 0);
+        CHECK (p.probs[0] == 1.0f);
+        CHECK (sum (p) == 1.0f);
+    }
+
+    SECTION ("only candidate strings get probability")
+    {
+        // C2: E string fret 8 or A string fret 3
+        const auto p = predict (65.4064f, kDefaultMaxFret);
+        CHECK (p.probs[2] == 0.0f);
+        CHECK (p.probs[3] == 0.0f);
+        CHECK ((p.stringIdx == 0 || p.stringIdx == 1));
+        CHECK_THAT (sum (p), Catch::Matchers::WithinAbs (1.0, 1e-3));
+    }
+
+    SECTION ("max fret narrows the candidates")
+    {
+        // A2 is E string fret 17, out of reach with a 12 fret limit
+        const auto p = predict (110.0f, 12);
+        CHECK (p.probs[0] == 0.0f);
+        CHECK (p.stringIdx != 0);
+        CHECK_THAT (sum (p), Catch::Matchers::WithinAbs (1.0, 1e-3));
+    }
+}
+
+TEST_CASE ("MLP classifier", "[classifier]")
+{
+    // 12 -> 5 -> 4: only beta reaches a hidden unit, which votes for the A string.
+    // Five hidden units don't fill whole SIMD registers, so the padding is exercised too.
+    const auto json = R"({
+        "scaler": { "mean": [0,0,0,0,0,0,0,0,0,0,0,100], "scale": [1,1,1,1,1,1,1,1,1,1,1,50] },
+        "mlp": {
+            "classes": [1,2,3,4], "activation": "relu",
+            "coefs": [
+                [[1,0,0,0,0], [0,0,0,0,0], [0,0,0,0,0], [0,0,0,0,0], [0,0,0,0,0], [0,0,0,0,0],
+                 [0,0,0,0,0], [0,0,0,0,0], [0,0,0,0,0], [0,0,0,0,0], [0,0,0,0,0], [0,0,0,0,-1]],
+                [[0,2,0,0], [0,0,0,0], [0,0,0,0], [0,0,0,0], [0,0,0,0]]
+            ],
+            "intercepts": [[0,0,0,0,0], [0,0,0,0]]
+        }
+    })";
+
+    juce::String error;
+    const auto model = StringModel::fromJson (json, error);
+    REQUIRE (model != nullptr);
+    CHECK (model->backend == StringModel::Backend::mlp);
+
+    StringClassifier classifier;
+    classifier.setModel (model.get());
+    const auto& standard = getTuning (tuningStandard4);
+
+    // A2 fits on every string up to fret 17
+    StringFeatures features {};
+    features[featureBeta] = 1.0f;
+    features[featureF0] = 110.0f;
+
+    SECTION ("softmax over the candidate strings")
+    {
+        const auto p = classifier.predict (features, standard, kMaxFretLimit);
+        const auto e2 = std::exp (2.0f);
+        CHECK (p.stringIdx == 1);
+        CHECK_THAT (p.probs[1], Catch::Matchers::WithinAbs (e2 / (e2 + 3.0f), 1e-5));
+        CHECK_THAT (p.probs[0], Catch::Matchers::WithinAbs (1.0f / (e2 + 3.0f), 1e-5));
+    }
+
+    SECTION ("strings out of reach are left out")
+    {
+        const auto p = classifier.predict (features, standard, 12);
+        const auto e2 = std::exp (2.0f);
+        CHECK (p.probs[0] == 0.0f);
+        CHECK_THAT (p.probs[1], Catch::Matchers::WithinAbs (e2 / (e2 + 2.0f), 1e-5));
+    }
+
+    SECTION ("only one hidden layer is supported")
+    {
+        const auto deep = juce::String (json).replace ("\"intercepts\": [[0,0,0,0,0], [0,0,0,0]]", "\"intercepts\": [[0,0,0,0,0], [0,0,0,0], [0]]");
+        CHECK (StringModel::fromJson (deep, error) == nullptr);
+        CHECK (error.isNotEmpty());
+    }
+}
+
+TEST_CASE ("k-NN classifier", "[classifier]")
+{
+    // Three samples per string, clustered along beta
+    juce::StringArray samples, labels;
+    for (int label = 1; label <= 4; ++label)
+    {
+        for (int i = 0; i < 3; ++i)
+        {
+            samples.add ("[" + juce::String (label) + "," + juce::String (0.1 * i) + ",0,0,0,0,0,0,0,0,0,110]");
+            labels.add (juce::String (label));
+        }
+    }
+
+    const auto json = R"({
+        "scaler": { "mean": [0,0,0,0,0,0,0,0,0,0,0,100], "scale": [1,1,1,1,1,1,1,1,1,1,1,50] },
+        "knn": { "classes": [1,2,3,4], "k": 3, "samples": [)" + samples.joinIntoString (",") + "], \"labels\": [" + labels.joinIntoString (",") + "] }\n}";
+
+    juce::String error;
+    const auto model = StringModel::fromJson (json, error);
+    REQUIRE (model != nullptr);
+    CHECK (model->backend == StringModel::Backend::knn);
+
+    StringClassifier classifier;
+    classifier.setModel (model.get());
+    const auto& standard = getTuning (tuningStandard4);
+
+    // A2 fits on every string up to fret 17
+    StringFeatures features {};
+    features[featureBeta] = 2.1f;
+    features[featureF0] = 110.0f;
+
+    SECTION ("the nearest samples vote")
+    {
+        const auto p = classifier.predict (features, standard, kMaxFretLimit);
+        CHECK (p.stringIdx == 1);
+        CHECK_THAT (p.probs[1], Catch::Matchers::WithinAbs (1.0, 1e-6));
+    }
+
+    SECTION ("only candidate strings' samples count")
+    {
+        // 12 frets keep A2 off the E string, the nearest samples are still the A string's
+        features[featureBeta] = 1.2f;
+        const auto p = classifier.predict (features, standard, 12);
+        CHECK (p.probs[0] == 0.0f);
+        CHECK (p.stringIdx == 1);
+    }
+
+    SECTION ("calibration samples are used without retraining")
+    {
+        // Three G string samples right where the query is
+        StringFeatures recorded[3] { features, features, features };
+        const int recordedLabels[] = { 4, 4, 4 };
+        const auto calibrated = model->withSamples (recorded, recordedLabels, 3);
+        REQUIRE (calibrated != nullptr);
+        CHECK (calibrated->knnIndex.getNumSamples() == model->knnIndex.getNumSamples() + 3);
+
+        StringClassifier calibratedClassifier;
+        calibratedClassifier.setModel (calibrated.get());
+        CHECK (calibratedClassifier.predict (features, standard, kMaxFretLimit).stringIdx == 3);
+        CHECK (classifier.predict (features, standard, kMaxFretLimit).stringIdx == 1);
+    }
+}
+
+TEST_CASE ("k-NN index is exact", "[classifier]")
+{
+    juce::Random random (11);
+    const auto gaussian = [&] { return (float) (std::sqrt (-2.0 * std::log (1.0 - random.nextDouble())) * std::cos (juce::MathConstants<double>::twoPi * random.nextDouble())); };
+
+    std::vector<float> samples;
+    std::vector<int> classes;
+    const auto addSample = [&] {
+        for (int f = 0; f < kNumFeatures; ++f)
+            samples.push_back (gaussian());
+        classes.push_back (random.nextInt (4));
+    };
+
+    for (int i = 0; i < 2000; ++i)
+        addSample();
+
+    KnnIndex index;
+    index.build (samples.data(), classes.data(), (int) classes.size());
+
+    // Appended samples go to the unindexed tail, or trigger a rebuild
+    for (int i = 0; i < 300; ++i)
+    {
+        addSample();
+        index.append (samples.data() + samples.size() - kNumFeatures, classes.back());
+    }
+    REQUIRE (index.getNumSamples() == 2300);
+
+    for (int q = 0; q < 200; ++q)
+    {
+        float query[kNumFeatures];
+        for (auto& x : query)
+            x = 1.5f * gaussian();
+
+        bool isCandidate[kMaxBassStrings] {};
+        for (int c = 0; c < 4; ++c)
+            isCandidate[c] = random.nextInt (3) != 0;
+        const int k = 1 + random.nextInt (KnnIndex::kMaxNeighbours);
+
+        std::vector<float> brute;
+        for (size_t i = 0; i < classes.size(); ++i)
+        {
+            if (! isCandidate[classes[i]])
+                continue;
+
+            float d = 0.0f;
+            for (size_t f = 0; f < (size_t) kNumFeatures; ++f)
+                d += (query[f] - samples[i * kNumFeatures + f]) * (query[f] - samples[i * kNumFeatures + f]);
+            brute.push_back (d);
+        }
+        std::sort (brute.begin(), brute.end());
+
+        KnnIndex::Neighbour found[KnnIndex::kMaxNeighbours];
+        const int numFound = index.search (query, k, isCandidate, found);
+        REQUIRE (numFound == std::min (k, (int) brute.size()));
+        for (int i = 0; i < numFound; ++i)
+            REQUIRE_THAT (found[i].distance, Catch::Matchers::WithinRel (brute[(size_t) i], 1e-4f));
+    }
+}
+
+TEST_CASE ("Physics prior", "[classifier]")
+{
+    // log β per string as a line over the fret (ln 2 / 6 per fret), tightly spread
+    const juce::String prior = R"("beta_prior": {
+        "classes": [1,2,3,4], "confidence": 0.9,
+        "curves": { "beta": [[-10,0.1155,0.1], [-9,0.1155,0.1], [-8,0.1155,0.1], [-7,0.1155,0.1]] }
+    })";
+
+    // An MLP that always says E, whatever the features
+    const auto json = "{" + prior + R"(,
+        "scaler": { "mean": [0,0,0,0,0,0,0,0,0,0,0,100], "scale": [1,1,1,1,1,1,1,1,1,1,1,50] },
+        "mlp": {
+            "classes": [1,2,3,4],
+            "coefs": [[[0],[0],[0],[0],[0],[0],[0],[0],[0],[0],[0],[0]], [[0,0,0,0]]],
+            "intercepts": [[0], [5,0,0,0]]
+        }
+    })";
+
+    juce::String error;
+    const auto model = StringModel::fromJson (json, error);
+    REQUIRE (model != nullptr);
+    CHECK (model->priorTerms.size() == 1);
+
+    StringClassifier classifier;
+    classifier.setModel (model.get());
+    const auto& standard = getTuning (tuningStandard4);
+
+    // D2: E string fret 10 (log β -8.85), A fret 5 (-8.42) or open D (-8)
+    const auto predict = [&] (float beta) {
+        StringFeatures features {};
+        features[featureBeta] = beta;
+        features[featureF0] = 73.4162f;
+        return classifier.predict (features, standard, kDefaultMaxFret);
+    };
+
+    SECTION ("a clear-cut β doesn't need the model")
+    {
+        const auto p = predict (std::exp (-8.0f));
+        CHECK (p.stringIdx == 2);
+        CHECK (p.probs[2] > 0.9f);
+        CHECK (p.probs[3] == 0.0f);
+    }
+
+    SECTION ("an ambiguous one is left to the model")
+    {
+        CHECK (predict (std::exp (-8.21f)).stringIdx == 0);
+        CHECK (predict (0.0f).stringIdx == 0); // unmeasured, the prior has nothing to go on
+    }
+
+    SECTION ("a prior on its own is a complete model")
+    {
+        const auto priorOnly = StringModel::fromJson ("{" + prior + "}", error);
+        REQUIRE (priorOnly != nullptr);
+        CHECK (priorOnly->backend == StringModel::Backend::prior);
+        classifier.setModel (priorOnly.get());
+
+        const auto p = predict (std::exp (-8.21f));
+        CHECK ((p.stringIdx == 1 || p.stringIdx == 2));
+        CHECK_THAT (p.probs[1], Catch::Matchers::WithinAbs (p.probs[2], 0.05));
+        CHECK_THAT (p.probs[0] + p.probs[1] + p.probs[2], Catch::Matchers::WithinAbs (1.0, 1e-5));
+    }
+
+    SECTION ("classes have to match the model's")
+    {
+        const auto mismatched = juce::String (json).replace ("\"classes\": [1,2,3,4], \"confidence\"", "\"classes\": [1,2,3], \"confidence\"");
+        CHECK (StringModel::fromJson (mismatched, error) == nullptr);
+        CHECK (error.isNotEmpty());
+    }
+}
+
+TEST_CASE ("Compiled-in model", "[classifier]")
+{
+    // TinySvmModel.h is generated from the same file at build time
+    juce::String error;
+    const auto loaded = StringModel::fromFile (juce::File (TINY_SVM_JSON), error);
+    REQUIRE (loaded != nullptr);
+
+    const auto compiled = makeFixedStringModel<TinySvmModel::kModel>();
+    CHECK (compiled->classLabels == loaded->classLabels);
+    CHECK (compiled->fitsTuning (getTuning (tuningStandard4)));
+
+    StringClassifier fromFile, fromHeader;
+    fromFile.setModel (loaded.get());
+    fromHeader.setModel (compiled.get());
+
+    // Features around the training distribution, some missing, over the whole range of f0
+    juce::Random random (7);
+    for (int i = 0; i < 500; ++i)
+    {
+        StringFeatures features {};
+        for (size_t f = 0; f < features.size(); ++f)
+            features[f] = loaded->scalerMean[f] + loaded->scalerScale[f] * (random.nextFloat() * 4.0f - 2.0f);
+        if (i % 7 == 0)
+            features[featureA4OverA1Log] = std::numeric_limits<float>::quiet_NaN();
+        features[featureF0] = 40.0f + 2.0f * (float) (i % 100);
+
+        const auto a = fromFile.predict (features, getTuning (tuningStandard4), kDefaultMaxFret);
+        const auto b = fromHeader.predict (features, getTuning (tuningStandard4), kDefaultMaxFret);
+        REQUIRE (a.stringIdx == b.stringIdx);
+        for (size_t s = 0; s < a.probs.size(); ++s)
+            REQUIRE_THAT (b.probs[s], Catch::Matchers::WithinAbs (a.probs[s], 1e-6));
+    }
+}
+
+TEST_CASE ("Double stops", "[multipitch]")
+{
+    AnalysisConfig config;
+    NoteAnalyser analyser;
+    analyser.prepare (kSampleRate, config);
+
+    // A1 on the A string with F#2 on the D string (a major sixth)
+    const auto mix = mixNotes ({ makeBassNote (kSampleRate, 55.0, 0.3), makeBassNote (kSampleRate, 92.499, 0.3) });
+    const auto frame = sustainWindow (mix, config);
+
+    AnalysisSettings settings;
+    settings.maxVoices = 2;
+
+    NoteEvent events[kMaxVoices];
+    const int numVoices = analyser.analyse (frame.data(), (int) frame.size(), settings, events);
+    REQUIRE (numVoices == 2);
+
+    const auto low = events[0].f0 < events[1].f0 ? events[0] : events[1];
+    const auto high = events[0].f0 < events[1].f0 ? events[1] : events[0];
+    CHECK_THAT (low.f0, Catch::Matchers::WithinRel (55.0, 0.01));
+    CHECK_THAT (high.f0, Catch::Matchers::WithinRel (92.499, 0.01));
+
+    SECTION ("each voice gets its own string")
+    {
+        CHECK (low.stringIdx != high.stringIdx);
+        CHECK (low.isValid());
+        CHECK (high.isValid());
+    }
+
+    SECTION ("a single note stays a single voice")
+    {
+        const auto single = sustainWindow (makeBassNote (kSampleRate, 73.4162, 0.3), config);
+        settings.maxVoices = 3;
+        CHECK (analyser.analyse (single.data(), (int) single.size(), settings, events) == 1);
+        CHECK_THAT (events[0].f0, Catch::Matchers::WithinRel (73.4162, 0.01));
+    }
+}
+
+TEST_CASE ("Stepped analysis", "[inline]")
+{
+    AnalysisConfig config;
+    NoteAnalyser analyser;
+    analyser.prepare (kSampleRate, config);
+
+    const auto frame = sustainWindow (makeBassNote (kSampleRate, 73.4162, 0.3), config);
+    AnalysisSettings settings;
+
+    NoteEvent whole[kMaxVoices];
+    REQUIRE (analyser.analyse (frame.data(), (int) frame.size(), settings, whole) == 1);
+
+    NoteEvent stepped[kMaxVoices];
+    analyser.begin (frame.data(), (int) frame.size(), settings);
+    int numSteps = 1;
+    while (! analyser.step (stepped))
+        ++numSteps;
+
+    // FFT, f0, then the one voice
+    CHECK (numSteps == 3);
+    CHECK (analyser.getNumVoices() == 1);
+    CHECK (stepped[0].f0 == whole[0].f0);
+    CHECK (stepped[0].stringIdx == whole[0].stringIdx);
+    CHECK (stepped[0].fret == whole[0].fret);
+}
+
+TEST_CASE ("Frame voting", "[decoder]")
+{
+    const auto& standard = getTuning (tuningStandard4);
+
+    // D2 on the E (10th fret) or A (5th fret) string
+    const auto frame = [&] (float f0, float probE, float probA) {
+        NoteEvent e;
+        e.f0 = f0;
+        e.stringProbs[0] = probE;
+        e.stringProbs[1] = probA;
+        e.stringIdx = probE > probA ? 0 : 1;
+        e.fret = standard.getFret (f0, e.stringIdx);
+        return e;
+    };
+
+    FrameVote vote;
+    vote.add (frame (73.5f, 0.4f, 0.6f));
+    vote.add (frame (73.3f, 0.7f, 0.3f));
+    vote.add (frame (90.0f, 0.8f, 0.2f)); // a glitched f0 the median ignores
+
+    SECTION ("log-probabilities add up across frames")
+    {
+        const auto result = vote.getResult (kDefaultMaxFret);
+        CHECK (vote.getNumFrames() == 3);
+        CHECK (result.stringIdx == 0);
+        CHECK (result.fret == 10);
+        CHECK (result.f0 == 73.5f);
+        CHECK_THAT (result.stringProbs[0] + result.stringProbs[1], Catch::Matchers::WithinAbs (1.0, 1e-5));
+    }
+
+    SECTION ("invalid and chord frames are left out")
+    {
+        NoteEvent chord = frame (73.4f, 0.1f, 0.9f);
+        chord.numVoices = 2;
+        vote.add (chord);
+        vote.add ({});
+        CHECK (vote.getNumFrames() == 3);
+    }
+
+    SECTION ("offline captures more of every note")
+    {
+        const auto live = AnalysisConfig();
+        const auto offline = AnalysisConfig::makeOffline();
+        CHECK (offline.getCaptureSamples (kSampleRate) > live.getCaptureSamples (kSampleRate));
+        CHECK (offline.numHarmonics > live.numHarmonics);
+        CHECK (offline.numVoteFrames <= FrameVote::kMaxFrames);
+    }
+
+    SECTION ("live voting doesn't hold back the first result")
+    {
+        const auto live = AnalysisConfig();
+        CHECK (live.numVoteFrames > 1);
+        CHECK (live.numVoteFrames <= FrameVote::kMaxFrames);
+        CHECK (live.provisionalResults);
+        CHECK_FALSE (AnalysisConfig::makeOffline().provisionalResults);
+    }
+}
+
+TEST_CASE ("Provisional results", "[inline]")
+{
+    AnalysisEngine engine;
+    engine.setInlineAnalysis (true);
+    engine.prepare (kSampleRate, 512);
+
+    AnalysisSettings settings;
+    settings.midiOutput = true;
+
+    // Some silence, then one note
+    std::vector<float> input (4410, 0.0f);
+    const auto note = makeBassNote (kSampleRate, 73.4162, 0.8);
+    input.insert (input.end(), note.begin(), note.end());
+
+    for (size_t pos = 0; pos < input.size(); pos += 512)
+        engine.process (input.data() + pos, (int) std::min ((size_t) 512, input.size() - pos), settings);
+
+    NoteEvent events[16];
+    const int numEvents = engine.popNoteEvents (events, (int) std::size (events));
+    NoteEvent midi[16];
+    const int numMidi = engine.popMidiEvents (midi, (int) std::size (midi));
+    engine.release();
+
+    // The first frame's guess, then the voted note for the same onset
+    REQUIRE (numEvents >= 2);
+    CHECK (events[0].provisional);
+    CHECK_FALSE (events[1].provisional);
+    CHECK (events[1].onsetSample == events[0].onsetSample);
+    CHECK_THAT (events[1].f0, Catch::Matchers::WithinRel (73.4162, 0.01));
+
+    // Only final notes are played out
+    REQUIRE (numMidi >= 1);
+    for (int i = 0; i < numMidi; ++i)
+        CHECK_FALSE (midi[i].provisional);
+}
+
+TEST_CASE ("Position decoding", "[decoder]")
+{
+    const auto& standard = getTuning (tuningStandard4);
+
+    // A note as the classifier would hand it over, probabilities per string E A D G
+    const auto makeNote = [&] (float f0, std::array<float, kMaxBassStrings> probs, double seconds) {
+        NoteEvent e;
+        e.f0 = f0;
+        e.stringProbs = probs;
+        e.stringIdx = (int) (std::max_element (probs.begin(), probs.end()) - probs.begin());
+        e.fret = standard.getFret (f0, e.stringIdx);
+        e.onsetSample = (int64_t) (seconds * kSampleRate);
+        return e;
+    };
+
+    PositionDecoder decoder;
+    decoder.prepare (kSampleRate);
+    NoteEvent out[PositionDecoder::kMaxOutput];
+
+    SECTION ("the hand position outweighs a marginal classifier preference")
+    {
+        decoder.setLookahead (0);
+        REQUIRE (decoder.push (makeNote ((float) standard.getFretFreq (1, 5), { 0.1f, 0.8f, 0.1f, 0.0f }, 0.0), kDefaultMaxFret, out) == 1);
+        CHECK (out[0].stringIdx == 1);
+
+        // G2: A string fret 10 by a hair, but D string fret 5 is under the hand
+        REQUIRE (decoder.push (makeNote (98.0f, { 0.05f, 0.45f, 0.4f, 0.1f }, 0.25), kDefaultMaxFret, out) == 1);
+        CHECK (out[0].stringIdx == 2);
+        CHECK (out[0].fret == 5);
+        CHECK (out[0].confidence == 0.4f);
+    }
+
+    SECTION ("lookahead lets the next note decide an ambiguous one")
+    {
+        decoder.setLookahead (1);
+
+        // A2 reads as A string fret 12, the next note is clearly D string fret 8
+        CHECK (decoder.push (makeNote (110.0f, { 0.0f, 0.5f, 0.45f, 0.05f }, 0.0), kDefaultMaxFret, out) == 0);
+        REQUIRE (decoder.push (makeNote ((float) standard.getFretFreq (2, 8), { 0.0f, 0.1f, 0.9f, 0.0f }, 0.25), kDefaultMaxFret, out) == 1);
+        CHECK (out[0].stringIdx == 2);
+        CHECK (out[0].fret == 7);
+
+        REQUIRE (decoder.flush (out) == 1);
+        CHECK (out[0].stringIdx == 2);
+        CHECK (out[0].fret == 8);
+        CHECK (decoder.getNumPending() == 0);
+    }
+
+    SECTION ("without lookahead the same note stays where the classifier put it")
+    {
+        decoder.setLookahead (0);
+        REQUIRE (decoder.push (makeNote (110.0f, { 0.0f, 0.5f, 0.45f, 0.05f }, 0.0), kDefaultMaxFret, out) == 1);
+        CHECK (out[0].stringIdx == 1);
+        CHECK (out[0].fret == 12);
+    }
+}
+
+TEST_CASE ("Legato pitch tracking", "[pitch]")
+{
+    AnalysisConfig config;
+    PitchTracker tracker;
+    tracker.prepare (kSampleRate, config.fMin, config.fMax);
+
+    // A hammer-on from A1 to B1 without a new pluck
+    auto line = makeBassNote (kSampleRate, 55.0, 0.4);
+    const auto hammer = makeBassNote (kSampleRate, 61.7354, 0.4);
+    line.insert (line.end(), hammer.begin(), hammer.end());
+
+    // Feed the tracker hop by hop over [from, to) and return its last estimate
+    const auto hop = (size_t) (kSampleRate * config.trackingHopMs / 1000.0);
+    const auto trackUntil = [&] (size_t from, size_t to) {
+        float f0 = 0.0f;
+        for (size_t end = from; end <= to; end += hop)
+        {
+            const auto n = (size_t) tracker.getRequiredWindow();
+            f0 = tracker.process (line.data() + end - n, (int) n);
+        }
+        return f0;
+    };
+
+    tracker.prime (55.0f);
+    const auto half = line.size() / 2;
+    CHECK_THAT (trackUntil (hop * 10, half), Catch::Matchers::WithinRel (55.0, 0.01));
+
+    // The new note sits inside the search band, so the tracker follows it
+    CHECK_THAT (trackUntil (half + hop * 5, line.size()), Catch::Matchers::WithinRel (61.7354, 0.01));
+
+    SECTION ("stays locked on a low B")
+    {
+        // The band around B0 reaches below fMin; it must still get enough signal
+        tracker.reset();
+        const int unlockedWindow = tracker.getRequiredWindow();
+
+        line = makeBassNote (kSampleRate, 30.8677, 0.4);
+        tracker.prime (30.8677f);
+        CHECK_THAT (trackUntil (hop * 10, line.size()), Catch::Matchers::WithinRel (30.8677, 0.01));
+        CHECK (tracker.getRequiredWindow() < unlockedWindow);
+    }
+}
+
+TEST_CASE ("Hum rejection", "[conditioning]")
+{
+    HumFilter hum;
+    hum.prepare (kSampleRate);
+
+    // 60 Hz mains with a couple of harmonics, about -40 dBFS
+    const auto mainsHum = [] (int n) {
+        const double t = n / kSampleRate;
+        return (float) (0.01 * std::sin (juce::MathConstants<double>::twoPi * 60.0 * t)
+                        + 0.005 * std::sin (juce::MathConstants<double>::twoPi * 120.0 * t)
+                        + 0.003 * std::sin (juce::MathConstants<double>::twoPi * 180.0 * t));
+    };
+
+    std::vector<float> block ((size_t) kSampleRate);
+    for (size_t i = 0; i < block.size(); ++i)
+        block[i] = mainsHum ((int) i);
+
+    hum.process (block.data(), (int) block.size(), true);
+    REQUIRE (hum.getMainsFrequency() == 60);
+
+    // Once settled, the hum is mostly gone
+    for (size_t i = 0; i < block.size(); ++i)
+        block[i] = mainsHum ((int) (block.size() + i));
+    hum.process (block.data(), (int) block.size(), true);
+
+    double residual = 0.0;
+    for (size_t i = block.size() / 2; i < block.size(); ++i)
+        residual += block[i] * block[i];
+    residual = std::sqrt (residual / (double) (block.size() / 2));
+    CHECK (residual < 0.01 * 0.1); // better than 20 dB down
+
+    SECTION ("a B1 right next to 60 Hz survives the notches")
+    {
+        auto note = makeBassNote (kSampleRate, 61.7354, 0.3);
+        AnalysisConfig config;
+        hum.process (note.data(), (int) note.size(), false);
+
+        YinPitchDetector yin;
+        yin.prepare (kSampleRate, config.getWindowSamples (kSampleRate), config.fMin, config.fMax);
+        const auto frame = sustainWindow (note, config);
+        CHECK_THAT (yin.estimate (frame.data(), (int) frame.size()), Catch::Matchers::WithinRel (61.7354, 0.01));
+    }
+}
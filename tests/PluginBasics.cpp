@@ -1,6 +1,10 @@
+#include "helpers/synthetic_bass.h"
 #include "helpers/test_helpers.h"
+#include <AnalysisThreadPool.h>
+#include <PluginState.h>
 #include <PluginProcessor.h>
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/matchers/catch_matchers_floating_point.hpp>
 #include <catch2/matchers/catch_matchers_string.hpp>
 
 TEST_CASE ("one is equal to one", "[dummy]")
@@ -19,6 +23,378 @@ TEST_CASE ("Plugin instance", "[instance]")
     }
 }
 
+TEST_CASE ("Parameters", "[instance]")
+{
+    PluginProcessor plugin;
+    auto& parameters = plugin.getValueTreeState();
+
+    for (const auto* id : { "doubleStops", "legatoTracking", "positionDecoding", "tuning", "maxFret", "onsetThreshold", "latencyMode", "midiOutput", "separateInputs" })
+        CHECK (parameters.getParameter (id) != nullptr);
+
+    SECTION ("the onset threshold is linear underneath and shown in dB")
+    {
+        CHECK_THAT (parameters.getRawParameterValue ("onsetThreshold")->load(), Catch::Matchers::WithinRel (0.01f, 1e-4f));
+        CHECK (parameters.getParameter ("onsetThreshold")->getCurrentValueAsText() == "-40.0 dB");
+    }
+
+    SECTION ("state round trip")
+    {
+        auto* tuning = parameters.getParameter ("tuning");
+        tuning->setValueNotifyingHost (tuning->convertTo0to1 ((float) tuningStandard5));
+
+        juce::MemoryBlock state;
+        plugin.getStateInformation (state);
+
+        PluginProcessor restored;
+        restored.setStateInformation (state.getData(), (int) state.getSize());
+        CHECK (restored.getTuningIndex() == tuningStandard5);
+    }
+
+    SECTION ("a truncated record is ignored")
+    {
+        // One whole parameter, then one cut off inside its value
+        juce::MemoryOutputStream params;
+        params.writeShort (2);
+        params.writeString ("tuning");
+        params.writeFloat ((float) tuningStandard5);
+        params.writeString ("maxFret");
+        params.writeShort (0);
+
+        // A model record without its path
+        juce::MemoryOutputStream models;
+        models.writeByte ((char) tuningStandard4);
+
+        PluginState::Writer writer;
+        writer.addSection (PluginState::parameters, params.getMemoryBlock());
+        writer.addSection (PluginState::modelFiles, models.getMemoryBlock());
+        juce::MemoryBlock state;
+        writer.writeTo (state);
+
+        plugin.setStateInformation (state.getData(), (int) state.getSize());
+        CHECK (plugin.getTuningIndex() == tuningStandard5);
+        CHECK ((int) parameters.getRawParameterValue ("maxFret")->load() == kDefaultMaxFret);
+    }
+}
+
+TEST_CASE ("Sidechain input", "[instance]")
+{
+    PluginProcessor plugin;
+    REQUIRE (plugin.getBusCount (true) == 2);
+
+    auto layout = plugin.getBusesLayout();
+    CHECK (plugin.checkBusesLayoutSupported (layout));
+
+    layout.inputBuses.getReference (1) = juce::AudioChannelSet::stereo();
+    CHECK (plugin.checkBusesLayoutSupported (layout));
+
+    layout.inputBuses.getReference (1) = juce::AudioChannelSet::create5point1();
+    CHECK_FALSE (plugin.checkBusesLayoutSupported (layout));
+
+    SECTION ("the main bus passes through untouched")
+    {
+        REQUIRE (plugin.enableAllBuses());
+        plugin.prepareToPlay (44100.0, 512);
+
+        const int numChannels = juce::jmax (plugin.getTotalNumInputChannels(), plugin.getTotalNumOutputChannels());
+        juce::AudioBuffer<float> buffer (numChannels, 512);
+        for (int c = 0; c < numChannels; ++c)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample (c, i, std::sin (0.05f * (float) (i * (c + 1))));
+
+        juce::AudioBuffer<float> original;
+        original.makeCopyOf (buffer);
+
+        juce::MidiBuffer midi;
+        plugin.processBlock (buffer, midi);
+        plugin.releaseResources();
+
+        for (int c = 0; c < plugin.getTotalNumOutputChannels(); ++c)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                REQUIRE (buffer.getSample (c, i) == original.getSample (c, i));
+    }
+}
+
+TEST_CASE ("Separate inputs", "[instance]")
+{
+    PluginProcessor plugin;
+    auto* separate = plugin.getValueTreeState().getParameter ("separateInputs");
+    separate->setValueNotifyingHost (1.0f);
+
+    // Offline analysis is done by the time processBlock returns
+    plugin.setNonRealtime (true);
+    plugin.prepareToPlay (44100.0, 512);
+
+    // A note on the right channel only, after some silence
+    const auto note = makeBassNote (44100.0, 73.4162, 0.8);
+    juce::AudioBuffer<float> input (plugin.getTotalNumInputChannels(), 4410 + (int) note.size());
+    input.clear();
+    input.copyFrom (1, 4410, note.data(), (int) note.size());
+
+    juce::MidiBuffer midi;
+    for (int pos = 0; pos < input.getNumSamples(); pos += 512)
+    {
+        juce::AudioBuffer<float> block (input.getArrayOfWritePointers(), input.getNumChannels(), pos,
+            juce::jmin (512, input.getNumSamples() - pos));
+        plugin.processBlock (block, midi);
+    }
+
+    NoteEvent events[16];
+    const int numEvents = plugin.popNoteEvents (events, (int) std::size (events));
+    plugin.releaseResources();
+
+    REQUIRE (numEvents > 0);
+    for (int i = 0; i < numEvents; ++i)
+        CHECK (events[i].input == 1);
+}
+
+TEST_CASE ("Only the inputs in use join the pool", "[instance]")
+{
+    // Every engine that has been prepared on a worker holds a reference to the pool
+    juce::SharedResourcePointer<AnalysisThreadPool> pool;
+    const auto baseline = pool.getNumberOfReferences();
+
+    PluginProcessor plugin;
+    REQUIRE (plugin.getTotalNumInputChannels() > 1);
+
+    plugin.prepareToPlay (44100.0, 512);
+    CHECK (pool.getNumberOfReferences() == baseline + 1);
+    plugin.releaseResources();
+
+    plugin.getValueTreeState().getParameter ("separateInputs")->setValueNotifyingHost (1.0f);
+    plugin.prepareToPlay (44100.0, 512);
+    CHECK (pool.getNumberOfReferences() == baseline + PluginProcessor::kMaxInputs);
+    plugin.releaseResources();
+}
+
+TEST_CASE ("MIDI output", "[instance]")
+{
+    PluginProcessor plugin;
+    plugin.getValueTreeState().getParameter ("midiOutput")->setValueNotifyingHost (1.0f);
+    plugin.setNonRealtime (true);
+    plugin.prepareToPlay (44100.0, 512);
+
+    // A note after some silence, then silence again
+    const auto note = makeBassNote (44100.0, 73.4162, 0.8);
+    juce::AudioBuffer<float> input (plugin.getTotalNumInputChannels(), 4410 + (int) note.size() + 44100);
+    input.clear();
+    for (int c = 0; c < input.getNumChannels(); ++c)
+        input.copyFrom (c, 4410, note.data(), (int) note.size());
+
+    int numOn = 0, numOff = 0;
+    for (int pos = 0; pos < input.getNumSamples(); pos += 512)
+    {
+        juce::AudioBuffer<float> block (input.getArrayOfWritePointers(), input.getNumChannels(), pos,
+            juce::jmin (512, input.getNumSamples() - pos));
+        juce::MidiBuffer midi;
+        plugin.processBlock (block, midi);
+
+        for (const auto metadata : midi)
+        {
+            numOn += metadata.getMessage().isNoteOn() ? 1 : 0;
+            numOff += metadata.getMessage().isNoteOff() ? 1 : 0;
+        }
+    }
+    plugin.releaseResources();
+
+    // Once the note has died away nothing is left hanging
+    CHECK (numOn >= 1);
+    CHECK (numOff == numOn);
+}
+
+TEST_CASE ("Binary state format", "[instance]")
+{
+    juce::MemoryBlock small ("abc", 3);
+    juce::MemoryBlock big (4096, true); // all zeros, compresses to almost nothing
+
+    PluginState::Writer writer;
+    writer.addSection (PluginState::parameters, small);
+    writer.addSection (PluginState::modelFiles, big);
+
+    juce::MemoryBlock state;
+    writer.writeTo (state);
+    CHECK (state.getSize() < 256);
+
+    SECTION ("sections come back as written")
+    {
+        PluginState::Reader reader;
+        REQUIRE (reader.parse (state.getData(), (int) state.getSize()));
+        CHECK (reader.getVersion() == PluginState::kVersion);
+        CHECK (reader.getSection (PluginState::parameters) == small);
+        CHECK (reader.getSection (PluginState::modelFiles) == big);
+    }
+
+    SECTION ("truncated or foreign data is rejected")
+    {
+        PluginState::Reader reader;
+        CHECK_FALSE (reader.parse (state.getData(), (int) state.getSize() - 1));
+        CHECK_FALSE (reader.parse ("<xml/>", 6));
+        CHECK_FALSE (reader.parse (nullptr, 0));
+    }
+
+    SECTION ("an implausible raw size is rejected")
+    {
+        // Raw size of the second (compressed) table entry, stored little-endian
+        auto* rawSize = static_cast<uint8_t*> (state.getData()) + 8 + 13 + 9;
+        std::fill (rawSize, rawSize + 4, (uint8_t) 0xff);
+
+        PluginState::Reader reader;
+        CHECK_FALSE (reader.parse (state.getData(), (int) state.getSize()));
+    }
+}
+
+TEST_CASE ("Shared model store", "[instance]")
+{
+    juce::SharedResourcePointer<StringModelStore> store;
+    PluginProcessor first, second;
+
+    // Both instances (processor and every input's engine) hold the one store rather than loading their own models
+    juce::SharedResourcePointer<StringModelStore> again;
+    CHECK (&store.get() == &again.get());
+    CHECK (store.getNumberOfReferences() == 2 + 2 * (1 + PluginProcessor::kMaxInputs));
+}
+
+TEST_CASE ("Model hot-swap", "[instance]")
+{
+    StringModelStore store;
+    const int reader = store.addReader();
+    REQUIRE (reader >= 0);
+
+    const auto replacement = std::make_shared<const StringModel>();
+
+    SECTION ("a pinned set outlives its replacement")
+    {
+        const StringModelStore::ReadScope pinned (store, reader);
+        const auto before = pinned.getModels()[tuningStandard4];
+        const auto version = pinned.getVersion();
+
+        store.publish (tuningStandard4, replacement);
+        CHECK (pinned.getModels()[tuningStandard4] == before);
+        CHECK (pinned.getVersion() == version);
+        CHECK_FALSE (store.reclaim());
+    }
+
+    SECTION ("the next scope sees the new set and the old one is freed")
+    {
+        uint64_t version = 0;
+        {
+            const StringModelStore::ReadScope pinned (store, reader);
+            version = pinned.getVersion();
+            store.publish (tuningStandard4, replacement);
+        }
+
+        CHECK (store.reclaim());
+
+        const StringModelStore::ReadScope pinned (store, reader);
+        CHECK (pinned.getModels()[tuningStandard4] == replacement);
+        CHECK (pinned.getVersion() > version);
+    }
+
+    store.removeReader (reader);
+}
+
+TEST_CASE ("Shared analysis pool", "[instance]")
+{
+    // Counts how often it's serviced, asks for more a few times
+    struct CountingClient : AnalysisThreadPool::Client
+    {
+        bool service() override { return ++calls < 3; }
+        int getServiceIntervalMs() const override { return 100; }
+        std::atomic<int> calls { 0 };
+    };
+
+    juce::SharedResourcePointer<AnalysisThreadPool> a, b;
+    CHECK (&a.get() == &b.get());
+    CHECK (a->getNumWorkers() >= 1);
+
+    CountingClient first, second;
+    a->add (&first);
+    b->add (&second);
+    a->notify();
+
+    for (int i = 0; i < 200 && (first.calls < 3 || second.calls < 3); ++i)
+        juce::Thread::sleep (5);
+
+    a->remove (&first);
+    b->remove (&second);
+    CHECK (first.calls >= 3);
+    CHECK (second.calls >= 3);
+
+    // Nothing touches a removed client
+    const int callsAfterRemove = first.calls;
+    a->notify();
+    juce::Thread::sleep (20);
+    CHECK (first.calls == callsAfterRemove);
+}
+
+TEST_CASE ("Inline fallback when the pool is full", "[instance]")
+{
+    struct IdleClient : AnalysisThreadPool::Client
+    {
+        bool service() override { return false; }
+        int getServiceIntervalMs() const override { return 100; }
+    };
+
+    // Take every slot, then the next instance has to do its own analysis
+    juce::SharedResourcePointer<AnalysisThreadPool> pool;
+    std::array<IdleClient, AnalysisThreadPool::kMaxClients> idle;
+    size_t numAdded = 0;
+    while (numAdded < idle.size() && pool->add (&idle[numAdded]))
+        ++numAdded;
+    CHECK_FALSE (pool->add (&idle.back()));
+
+    AnalysisEngine engine;
+    engine.prepare (44100.0, 512);
+    CHECK (engine.isInlineAnalysis());
+
+    // It still finds notes, in process() instead of on a worker
+    AnalysisSettings settings;
+    std::vector<float> input (4410, 0.0f);
+    const auto note = makeBassNote (44100.0, 73.4162, 0.8);
+    input.insert (input.end(), note.begin(), note.end());
+    for (size_t pos = 0; pos < input.size(); pos += 512)
+        engine.process (input.data() + pos, (int) std::min ((size_t) 512, input.size() - pos), settings);
+
+    NoteEvent events[16];
+    CHECK (engine.popNoteEvents (events, (int) std::size (events)) >= 1);
+    engine.release();
+
+    for (size_t i = 0; i < numAdded; ++i)
+        pool->remove (&idle[i]);
+
+    // With room again it goes back to the pool
+    engine.prepare (44100.0, 512);
+    CHECK_FALSE (engine.isInlineAnalysis());
+    engine.release();
+}
+
+TEST_CASE ("Analysis without a model reader slot", "[instance]")
+{
+    // Take every reader slot, then the next engine has to keep a copy of the models
+    juce::SharedResourcePointer<StringModelStore> store;
+    std::vector<int> readers;
+    for (int r = store->addReader(); r >= 0; r = store->addReader())
+        readers.push_back (r);
+    CHECK (store->addReader() < 0);
+
+    // Offline, so the notes are done by the time process() returns
+    AnalysisEngine engine;
+    engine.setOffline (true);
+    engine.prepare (44100.0, 512);
+
+    AnalysisSettings settings;
+    std::vector<float> input (4410, 0.0f);
+    const auto note = makeBassNote (44100.0, 73.4162, 0.8);
+    input.insert (input.end(), note.begin(), note.end());
+    for (size_t pos = 0; pos < input.size(); pos += 512)
+        engine.process (input.data() + pos, (int) std::min ((size_t) 512, input.size() - pos), settings);
+
+    NoteEvent events[16];
+    CHECK (engine.popNoteEvents (events, (int) std::size (events)) >= 1);
+    engine.release();
+
+    for (const auto r : readers)
+        store->removeReader (r);
+}
 
 #ifdef PAMPLEJUCE_IPP
     #include <ipp.h>
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+/* Synthetic plucked bass notes for DSP tests.
+ *
+ * A stiff string: partial n sits at n * f0 * sqrt (1 + beta * n^2), with a
+ * 1/n amplitude roll-off and a faster decay for higher partials. Good enough
+ * to exercise f0 estimation, harmonic tracking and multi-f0 without audio files.
+ */
+[[maybe_unused]] static std::vector<float> makeBassNote (double sampleRate,
+    double f0,
+    double seconds,
+    double beta = 1.0e-4,
+    float amplitude = 0.5f,
+    int numPartials = 20)
+{
+    const auto numSamples = (size_t) (sampleRate * seconds);
+    std::vector<float> out (numSamples, 0.0f);
+
+    for (int n = 1; n <= numPartials; ++n)
+    {
+        const double fn = n * f0 * std::sqrt (1.0 + beta * n * n);
+        if (fn >= sampleRate * 0.45)
+            break;
+
+        const double w = 2.0 * std::numbers::pi * fn / sampleRate;
+        const double a = amplitude / n;
+        const double decay = 1.5 + 0.4 * n; // 1/s
+        const double phase = 0.37 * n;
+        for (size_t i = 0; i < numSamples; ++i)
+            out[i] += (float) (a * std::exp (-decay * (double) i / sampleRate) * std::sin (w * (double) i + phase));
+    }
+
+    return out;
+}
+
+// Sum of several notes (double stops / chords)
+[[maybe_unused]] static std::vector<float> mixNotes (const std::vector<std::vector<float>>& notes)
+{
+    std::vector<float> out;
+    for (const auto& n : notes)
+    {
+        if (n.size() > out.size())
+            out.resize (n.size(), 0.0f);
+        for (size_t i = 0; i < n.size(); ++i)
+            out[i] += n[i];
+    }
+    return out;
+}
@@ -0,0 +1,149 @@
+# Turns an exported string model (svm_export_for_juce.json) into EmbeddedModel.h,
+# the constexpr data for one FixedStringModel (source/FixedStringModel.h).
+# Runs as a build step, see BASSAID_EMBEDDED_MODEL in CMakeLists.txt:
+#
+#   cmake -DMODEL_JSON=<model.json> -DOUTPUT=<EmbeddedModel.h> -DTUNING=<index> -DNAMESPACE=<name> -P GenerateModelHeader.cmake
+
+foreach (var MODEL_JSON OUTPUT TUNING NAMESPACE)
+    if (NOT DEFINED ${var})
+        message(FATAL_ERROR "GenerateModelHeader: ${var} is not set")
+    endif ()
+endforeach ()
+
+file(READ "${MODEL_JSON}" json)
+
+string(JSON hasSvm ERROR_VARIABLE noSvm GET "${json}" svm)
+if (noSvm)
+    message(FATAL_ERROR "${MODEL_JSON}: only SVM models can be compiled in")
+endif ()
+
+# A JSON number, or array (of arrays) of numbers, as a C initialiser: float literals
+# for anything with a fraction or exponent, nulls (NaN in the notebook) as NaN
+function(json_to_initialiser out)
+    string(JSON text GET "${json}" ${ARGN})
+    string(REPLACE "[" "{" text "${text}")
+    string(REPLACE "]" "}" text "${text}")
+    string(REPLACE "null" "std::numeric_limits<float>::quiet_NaN()" text "${text}")
+    string(REGEX REPLACE "([0-9]+\\.[0-9]+([eE][-+]?[0-9]+)?|[0-9]+[eE][-+]?[0-9]+)" "\\1f" text "${text}")
+    string(REGEX REPLACE "[ \t\r\n]+" " " text "${text}")
+    set(${out} "${text}" PARENT_SCOPE)
+endfunction()
+
+function(json_length out)
+    string(JSON length LENGTH "${json}" ${ARGN})
+    set(${out} ${length} PARENT_SCOPE)
+endfunction()
+
+json_length(numFeatures scaler mean)
+json_length(numSupportVectors svm support_vectors)
+json_length(numClasses svm classes)
+json_length(numDualRows svm dual_coef)
+math(EXPR numPairs "${numClasses} * (${numClasses} - 1) / 2")
+
+if (numClasses LESS 2)
+    message(FATAL_ERROR "${MODEL_JSON}: needs at least two classes")
+endif ()
+
+# The compiler would quietly zero-fill short rows, so check the shapes here
+math(EXPR expectedDualRows "${numClasses} - 1")
+if (NOT numDualRows EQUAL expectedDualRows)
+    message(FATAL_ERROR "${MODEL_JSON}: dual_coef has ${numDualRows} rows, expected ${expectedDualRows}")
+endif ()
+
+foreach (row RANGE 1 ${numDualRows})
+    math(EXPR row "${row} - 1")
+    json_length(length svm dual_coef ${row})
+    if (NOT length EQUAL numSupportVectors)
+        message(FATAL_ERROR "${MODEL_JSON}: dual_coef row ${row} has ${length} entries, expected ${numSupportVectors}")
+    endif ()
+endforeach ()
+
+foreach (sv RANGE 1 ${numSupportVectors})
+    math(EXPR sv "${sv} - 1")
+    json_length(length svm support_vectors ${sv})
+    if (NOT length EQUAL numFeatures)
+        message(FATAL_ERROR "${MODEL_JSON}: support vector ${sv} has ${length} features, expected ${numFeatures}")
+    endif ()
+endforeach ()
+
+# classCount says where each class's support vectors start, so it has to cover them exactly
+json_length(numClassCounts svm n_support)
+if (NOT numClassCounts EQUAL numClasses)
+    message(FATAL_ERROR "${MODEL_JSON}: n_support has ${numClassCounts} entries, expected ${numClasses}")
+endif ()
+
+set(supportVectorSum 0)
+foreach (c RANGE 1 ${numClassCounts})
+    math(EXPR c "${c} - 1")
+    string(JSON count GET "${json}" svm n_support ${c})
+    math(EXPR supportVectorSum "${supportVectorSum} + ${count}")
+endforeach ()
+if (NOT supportVectorSum EQUAL numSupportVectors)
+    message(FATAL_ERROR "${MODEL_JSON}: n_support adds up to ${supportVectorSum}, there are ${numSupportVectors} support vectors")
+endif ()
+
+json_length(numIntercepts svm intercept)
+if (NOT numIntercepts EQUAL numPairs)
+    message(FATAL_ERROR "${MODEL_JSON}: ${numIntercepts} intercepts, expected ${numPairs}")
+endif ()
+
+json_to_initialiser(classLabels svm classes)
+json_to_initialiser(classCount svm n_support)
+json_to_initialiser(scalerMean scaler mean)
+json_to_initialiser(scalerScale scaler scale)
+json_to_initialiser(supportVectors svm support_vectors)
+json_to_initialiser(dualCoef svm dual_coef)
+json_to_initialiser(intercept svm intercept)
+json_to_initialiser(gamma svm gamma)
+
+# Without an imputer, missing features fall back to the scaler mean, same as a loaded model
+string(JSON imputer ERROR_VARIABLE noImputer GET "${json}" imputer statistics)
+if (noImputer)
+    set(imputerMedians "${scalerMean}")
+else ()
+    json_to_initialiser(imputerMedians imputer statistics)
+endif ()
+
+string(JSON probA ERROR_VARIABLE noProbA GET "${json}" svm probA)
+string(JSON probB ERROR_VARIABLE noProbB GET "${json}" svm probB)
+if (noProbA OR noProbB)
+    set(hasProbabilities false)
+    set(probA "{}")
+    set(probB "{}")
+else ()
+    set(hasProbabilities true)
+    json_to_initialiser(probA svm probA)
+    json_to_initialiser(probB svm probB)
+endif ()
+
+get_filename_component(modelName "${MODEL_JSON}" NAME)
+file(WRITE "${OUTPUT}.tmp" "// Generated from ${modelName} by tools/GenerateModelHeader.cmake, don't edit
+#pragma once
+
+#include \"FixedStringModel.h\"
+#include <limits>
+
+namespace ${NAMESPACE}
+{
+    constexpr int kTuning = ${TUNING};
+
+    inline constexpr FixedStringModel<${numFeatures}, ${numSupportVectors}, ${numClasses}> kModel {
+        .classLabels = ${classLabels},
+        .classCount = ${classCount},
+        .scalerMean = ${scalerMean},
+        .scalerScale = ${scalerScale},
+        .imputerMedians = ${imputerMedians},
+        .gamma = ${gamma},
+        .supportVectors = ${supportVectors},
+        .dualCoef = ${dualCoef},
+        .intercept = ${intercept},
+        .probA = ${probA},
+        .probB = ${probB},
+        .hasProbabilities = ${hasProbabilities},
+    };
+} // namespace ${NAMESPACE}
+")
+
+# Only touch the header when the model changed, so rebuilding the plugin doesn't recompile it
+file(COPY_FILE "${OUTPUT}.tmp" "${OUTPUT}" ONLY_IF_DIFFERENT)
+file(REMOVE "${OUTPUT}.tmp")